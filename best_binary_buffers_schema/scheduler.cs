@@ -104,6 +104,14 @@ public class RequestSchedulerSave
 	public IScheduleContainer Payload;
 }
 
+/// Massenimport mehrerer Schedules (z.B. ein ganzer Satz aus der UI) mit einem einzigen NVS-Commit. Gleichnamige
+/// vorhandene Schedules werden ersetzt; Antwort ist wie bei RequestSchedulerSave die aktualisierte ResponseSchedulerList.
+[BinaryMessage(MessageKind.Request)]
+public class RequestSchedulerSaveBatch
+{
+	public IScheduleContainer[] Schedules;
+}
+
 [BinaryMessage(MessageKind.Response)]
 public class ResponseSchedulerSave
 {
@@ -125,3 +133,21 @@ public class RequestSchedulerDelete
 {
 	public string Name;
 }
+
+/// Abonniert (Subscribe=true) bzw. kuendigt (false) NotifyScheduleChanged fuer ein Schedule. Als Bestaetigung
+/// eines Abonnements kommt sofort ein NotifyScheduleChanged mit dem aktuellen Wert; eine eigene Response gibt es nicht.
+[BinaryMessage(MessageKind.Request)]
+public class RequestSchedulerSubscribe
+{
+	public string Name;
+	public bool Subscribe;
+}
+
+/// Server-Push an die abonnierenden Tabs bei jedem Wertwechsel. NextChangeEpoch=-1: kein Wechsel absehbar.
+[BinaryMessage(MessageKind.Event)]
+public class NotifyScheduleChanged
+{
+	public string Name;
+	public ushort Value;
+	public long NextChangeEpoch;
+}
@@ -60,3 +60,91 @@ public class ResponseSystemData
 	public float ChipTemperature;
 	public IPartitionInfo[] Partitions;
 }
+
+[BinaryUnion]
+public interface IFramePoolClass
+{
+}
+
+/// Belegung einer Groessenklasse des Websocket-Frame-Pools (s. webmanager_frame_pool.hh).
+[BinaryType]
+public class FramePoolClass : IFramePoolClass
+{
+	public ushort SlotSize;
+	public ushort SlotCount;
+	public ushort InUse;
+	public ushort HighWater;
+	public uint ReserveFailures;
+}
+
+[BinaryMessage(MessageKind.Request)]
+public class RequestWebsocketStatistics
+{
+}
+
+[BinaryMessage(MessageKind.Response)]
+public class ResponseWebsocketStatistics
+{
+	public uint OversizeRequests;
+	public ushort ActiveSessions;
+	public ushort QueueHighWater;
+	public uint Coalesced;
+	public uint DroppedMustDeliver;
+	public uint DroppedDropOldest;
+	public uint DroppedCoalesceLatest;
+	public uint SendErrors;
+	public uint TxFrames;
+	public uint TxBytes;
+	public ulong SendTimeTotalUs;
+	public uint SendTimeMaxUs;
+	public uint RxFrames;
+	public uint RxBytes;
+	public uint RxOversizeFrames;
+	public uint Dispatched;
+	public ulong DispatchTimeTotalUs;
+	public uint DispatchTimeMaxUs;
+	public uint PoolReserves;
+	public IFramePoolClass[] PoolClasses;
+}
+
+[BinaryUnion]
+public interface ITimeseriesGranularityHealth
+{
+}
+
+/// Flash-Verschleiss des Sektor-Rings einer Timeseries-Granularitaet (s. timeseries::GranularityHealth).
+/// YearsLeft = -1: noch nicht abschaetzbar.
+[BinaryType]
+public class TimeseriesGranularityHealth : ITimeseriesGranularityHealth
+{
+	public byte Granularity;
+	public ushort SectorCount;
+	public uint MinEraseCount;
+	public uint MaxEraseCount;
+	public uint WritesPerDay;
+	public uint ErasesPerDay;
+	public float YearsLeft;
+}
+
+[BinaryMessage(MessageKind.Request)]
+public class RequestTimeseriesHealth
+{
+}
+
+/// SamplePeriodMs..WorkerLatencyMaxUs: Abtastung, s. timeseries::SamplingStats.
+[BinaryMessage(MessageKind.Response)]
+public class ResponseTimeseriesHealth
+{
+	public uint EraseEndurance;
+	public uint SecondsObserved;
+	public uint WritesPerDay;
+	public uint ErasesPerDay;
+	public float YearsLeft;
+	public ITimeseriesGranularityHealth[] Granularities;
+	public uint SamplePeriodMs;
+	public uint Samples;
+	public uint SamplesDropped;
+	public uint JitterMaxUs;
+	public uint JitterMeanUs;
+	public uint WorkerLatencyMaxUs;
+}
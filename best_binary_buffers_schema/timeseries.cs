@@ -0,0 +1,46 @@
+// ws-protocol-Schema fuer den 'timeseries'-Namespace (neu, kein Flatbuffers-Vorgaenger). Bereichsabfrage ueber
+// timeseries::iTimeseries::Query. Eine Antwort umfasst hoechstens ein Frame-Pool-Fach; ist der Bereich groesser,
+// ist Complete=false und der Client fragt ab NextFromEpoch erneut an. values ist eine klassische einklassige
+// Union-Liste, ein Element je (Zeitpunkt, angeforderter Kanal).
+using BestBinaryBuffers;
+
+namespace timeseries;
+
+[BinaryUnion]
+public interface ITimeseriesValue
+{
+}
+
+/// Ein Kanal eines Datensatzes; bei RecordLayout MEAN (0) sind Min, Max und Last gleich Mean.
+[BinaryType]
+public class TimeseriesValue : ITimeseriesValue
+{
+	public long SecondsEpoch;
+	public byte Channel;
+	public float Mean;
+	public float Min;
+	public float Max;
+	public float Last;
+}
+
+/// Granularity: 0=10s, 1=1min, 2=1h, 3=1d. ChannelMask: Bit n = Kanal n.
+[BinaryMessage(MessageKind.Request)]
+public class RequestTimeseries
+{
+	public byte Granularity;
+	public long FromEpoch;
+	public long ToEpoch;
+	public uint ChannelMask;
+}
+
+[BinaryMessage(MessageKind.Response)]
+public class ResponseTimeseries
+{
+	public byte Granularity;
+	public byte RecordLayout;
+	public byte Channels;
+	public byte SampleType;
+	public bool Complete;
+	public long NextFromEpoch;
+	public ITimeseriesValue[] Values;
+}
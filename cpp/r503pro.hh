@@ -13,6 +13,7 @@
 #include "nvs.h"
 #include "sdkconfig.h"
 #include "esp_log.h"
+#include "esp_attr.h"
 #include <common.hh>
 #include "fingerprint_interfaces.hh"
 #include "grow_fingerprint_serial_protocol.hh"
@@ -27,11 +28,23 @@ namespace r503pro
     private:
         gpio_num_t gpio_irq;
         grow_fingerprint::SystemParameter params;
-        bool previousIrqLineValue{true};
+        TaskHandle_t taskHandle{nullptr};
 
-        bool isInEnrollment{false};
+        volatile bool isInEnrollment{false};
         fingerprint::iFingerprintHandler *handler;
 
+        // Negative Flanke der Touch-Leitung weckt den Task per Task-Notification; im Ruhezustand keine Wakeups.
+        // Der Handler ist schon vor dem Task registriert, eine Flanke davor wird ignoriert.
+        static void IRAM_ATTR irqLineIsr(void *arg)
+        {
+            TaskHandle_t t = ((R503Pro *)arg)->taskHandle;
+            if (!t)
+                return;
+            BaseType_t higherPriorityTaskWoken{pdFALSE};
+            vTaskNotifyGiveFromISR(t, &higherPriorityTaskWoken);
+            portYIELD_FROM_ISR(higherPriorityTaskWoken);
+        }
+
         void task()
         {
             vTaskDelay(grow_fingerprint::POWER_UP_DELAY_TICKS);
@@ -41,11 +54,14 @@ namespace r503pro
                 if (isInEnrollment)
                 {
                     task_enroll();
+                    if (!isInEnrollment)
+                        ulTaskNotifyTake(pdTRUE, 0); // Flanken waehrend des Anlernens sind keine Erkennungsversuche
                 }
                 else
                 {
-                    vTaskDelay(pdMS_TO_TICKS(100));
-                    task_detect();
+                    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                    if (!isInEnrollment)
+                        task_detect();
                 }
             }
         }
@@ -77,10 +93,9 @@ namespace r503pro
 
         void task_detect()
         {
-            bool newIrqValue = gpio_get_level(gpio_irq);
-            if (previousIrqLineValue == true && newIrqValue == false)
+            // Entprellen: eine Stoerflanke, nach der die Leitung schon wieder high ist, ist kein Finger
+            if (gpio_get_level(gpio_irq) == 0)
             {
-                // negative edge detected
                 ESP_LOGD(TAG, "Negative edge detected, trying to read fingerprint");
                 uint16_t fingerIndex;
                 uint16_t score;
@@ -99,7 +114,8 @@ namespace r503pro
                         handler->HandleFingerprintDetected((uint8_t)ret, 0, 0);
                 }
             }
-            previousIrqLineValue = newIrqValue;
+            // Prellen und erneutes Auflegen waehrend AutoIdentify loesen keinen zweiten Versuch aus
+            ulTaskNotifyTake(pdTRUE, 0);
         }
 
         grow_fingerprint::RET ReadAllSysPara(grow_fingerprint::SystemParameter &outParams)
@@ -125,6 +141,8 @@ namespace r503pro
         {
             grow_fingerprint::PackageCreatorAndParser::AutoEnroll(fingerIndexOr0xFFFF_inout, overwriteExisting, duplicateFingerAllowed, returnStatusDuringProcess, fingerHasToLeaveBetweenScans);
             this->isInEnrollment=true;
+            if (taskHandle)
+                xTaskNotifyGive(taskHandle); // der Task wartet sonst unbegrenzt auf die naechste Flanke
             return grow_fingerprint::RET::OK;
         }
 
@@ -237,8 +255,30 @@ namespace r503pro
 
             ESP_LOGI(TAG, "Successfully connected with fingerprint {'addr':%lu, 'securityLevel':%u, 'libSize':%u, 'libUsed':%u, 'fwVer':'%s', 'algVer'='%s', 'status':%u, 'baud9600':%u}", params.deviceAddress, params.securityLevel, params.librarySizeMax, params.librarySizeUsed, params.fwVer, params.algVer, params.status, params.baudRateTimes9600);
 
-            xTaskCreate([](void *p)
-                        { ((R503Pro *)p)->task(); }, "fingerprint", 3072, this, 10, nullptr);
+            // erst den Interrupt, dann den Task: schlaegt etwas fehl, bleibt kein Task zurueck, der nie geweckt wird
+            esp_err_t err = gpio_set_intr_type(gpio_irq, GPIO_INTR_NEGEDGE);
+            if (err == ESP_OK)
+            {
+                err = gpio_install_isr_service(0);
+                if (err == ESP_ERR_INVALID_STATE) // schon von anderer Stelle installiert
+                    err = ESP_OK;
+            }
+            if (err == ESP_OK)
+                err = gpio_isr_handler_add(gpio_irq, irqLineIsr, this);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Could not set up the interrupt of the fingerprint touch line %d. Error %d", (int)gpio_irq, err);
+                return grow_fingerprint::RET::HARDWARE_ERROR;
+            }
+
+            if (xTaskCreate([](void *p)
+                            { ((R503Pro *)p)->task(); }, "fingerprint", 3072, this, 10, &taskHandle) != pdPASS)
+            {
+                ESP_LOGE(TAG, "Could not create the fingerprint task");
+                gpio_isr_handler_remove(gpio_irq);
+                taskHandle = nullptr;
+                return grow_fingerprint::RET::HARDWARE_ERROR;
+            }
             return grow_fingerprint::RET::OK;
         }
     };
@@ -5,6 +5,7 @@
 #include <cstring>
 #include <cstdio>
 #include <memory>
+#include <array>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/uart.h"
@@ -22,6 +23,9 @@
 #include "esp_log.h"
 namespace fingerprint
 {
+    // Fingerindizes, die Begin ueber die (erste Seite der) Template-Index-Tabelle des Sensors sieht -- nur diese
+    // bekommen einen Eintrag im RAM-Index, hoehere (bis 0x05DC) laufen wie bisher ueber NVS.
+    constexpr uint16_t FINGER_META_CAPACITY{sizeof(grow_fingerprint::SystemParameter::libraryIndicesUsed) * 8};
 
     class R503ProManager : public r503pro::R503Pro, public fingerprint::iFingerprintHandler
     {
@@ -33,8 +37,66 @@ namespace fingerprint
         nvs_handle_t nvsFingerIndex2ActionIndex;
         SemaphoreHandle_t mutex;
 
+        // RAM-Abbild von nvsFingerIndex2ActionIndex/nvsFingerIndex2SchedulerName, damit HandleFingerprintDetected ohne
+        // NVS-Zugriff und ohne String auskommt. In Begin geladen, von HandleEnrollmentUpdate, TryStore* und TryDelete*
+        // nach dem NVS-Schreiben nachgezogen. Geschrieben wird aus dem httpd-Task, gelesen im Fingerprint-Task -- jeder
+        // Zugriff nur unter 'mutex' (kurz, nie waehrend einer Sensor-Kommunikation).
+        struct FingerMeta
+        {
+            webmanager::ScheduleHandle schedule;
+            uint16_t actionIndex;
+            bool known;
+        };
+        std::array<FingerMeta, FINGER_META_CAPACITY> fingerMeta{};
+
+        // liest die Zuordnung eines Fingers aus NVS und loest den Schedule-Namen auf
+        FingerMeta readFingerMeta(uint16_t fingerIndex)
+        {
+            char fingerIndexAsString[6];
+            snprintf(fingerIndexAsString, 6, "%d", fingerIndex);
+            FingerMeta m{webmanager::INVALID_SCHEDULE_HANDLE, 0, false};
+            if (nvs_get_u16(this->nvsFingerIndex2ActionIndex, fingerIndexAsString, &m.actionIndex) != ESP_OK)
+                return m;
+            m.known = true;
+            char schedulerName[NVS_KEY_NAME_MAX_SIZE];
+            size_t schedulerNameLen{sizeof(schedulerName)};
+            if (nvs_get_str(this->nvsFingerIndex2SchedulerName, fingerIndexAsString, schedulerName, &schedulerNameLen) == ESP_OK && scheduler)
+                m.schedule = scheduler->ResolveSchedule(schedulerName);
+            return m;
+        }
+
+        void refreshFingerMeta(uint16_t fingerIndex)
+        {
+            if (fingerIndex >= FINGER_META_CAPACITY)
+                return;
+            xSemaphoreTake(mutex, portMAX_DELAY);
+            fingerMeta[fingerIndex] = readFingerMeta(fingerIndex);
+            xSemaphoreGive(mutex);
+        }
+
+        void clearFingerMeta()
+        {
+            xSemaphoreTake(mutex, portMAX_DELAY);
+            fingerMeta.fill({webmanager::INVALID_SCHEDULE_HANDLE, 0, false});
+            xSemaphoreGive(mutex);
+        }
+
+        // Kopie des RAM-Eintrags; Finger ausserhalb des RAM-Index direkt aus NVS
+        FingerMeta fingerMetaOf(uint16_t fingerIndex)
+        {
+            if (fingerIndex >= FINGER_META_CAPACITY)
+                return readFingerMeta(fingerIndex);
+            xSemaphoreTake(mutex, portMAX_DELAY);
+            FingerMeta m = fingerMeta[fingerIndex];
+            xSemaphoreGive(mutex);
+            return m;
+        }
+
     public:
-        R503ProManager(uart_port_t uart_num, gpio_num_t gpio_irq, fingerprint::iFingerprintActionHandler *handler, webmanager::iScheduler *scheduler, nvs_handle_t nvsFingerName2FingerIndex, nvs_handle_t nvsFingerIndex2SchedulerName, nvs_handle_t nvsFingerIndex2ActionIndex, uint32_t targetAddress = grow_fingerprint::DEFAULT_ADDRESS) : R503Pro(uart_num, gpio_irq, this), handler(handler), scheduler(scheduler), nvsFingerName2FingerIndex(nvsFingerName2FingerIndex), nvsFingerIndex2SchedulerName(nvsFingerIndex2SchedulerName), nvsFingerIndex2ActionIndex(nvsFingerIndex2ActionIndex) {}
+        R503ProManager(uart_port_t uart_num, gpio_num_t gpio_irq, fingerprint::iFingerprintActionHandler *handler, webmanager::iScheduler *scheduler, nvs_handle_t nvsFingerName2FingerIndex, nvs_handle_t nvsFingerIndex2SchedulerName, nvs_handle_t nvsFingerIndex2ActionIndex, uint32_t targetAddress = grow_fingerprint::DEFAULT_ADDRESS) : R503Pro(uart_num, gpio_irq, this), handler(handler), scheduler(scheduler), nvsFingerName2FingerIndex(nvsFingerName2FingerIndex), nvsFingerIndex2SchedulerName(nvsFingerIndex2SchedulerName), nvsFingerIndex2ActionIndex(nvsFingerIndex2ActionIndex)
+        {
+            mutex = xSemaphoreCreateMutex();
+        }
 
         void HandleFingerprintDetected(uint16_t errorCode, uint16_t fingerIndex, uint16_t score)
         {
@@ -47,18 +109,15 @@ namespace fingerprint
 
             if (handler)
             {
-                char fingerIndexAsString[6];
-                snprintf(fingerIndexAsString, 6, "%d", fingerIndex);
-                uint16_t actionIndex{0};
-                
-                nvs_get_u16(this->nvsFingerIndex2ActionIndex, fingerIndexAsString, &actionIndex);
-                size_t schedulerNameLen{16};
-                nvs_get_str(this->nvsFingerIndex2SchedulerName, fingerIndexAsString, nullptr, &schedulerNameLen);
-                char schedulerName[schedulerNameLen];
-                nvs_get_str(this->nvsFingerIndex2SchedulerName, fingerIndexAsString, schedulerName, &schedulerNameLen);
-                ESP_LOGI(TAG, "Fingerprint detected successfully: fingerIndex=%d, schedulerName=%s actionIndex=%d", fingerIndex, schedulerName, actionIndex);
-                if (scheduler->GetCurrentValueOfSchedule(schedulerName)>0){
-                    handler->HandleFingerprintAction(fingerIndex, actionIndex);
+                FingerMeta m = fingerMetaOf(fingerIndex);
+                if (m.known && !scheduler->IsValid(m.schedule))
+                { // selten: Schedule geloescht und neu angelegt, oder der Scheduler hat erst nach unserem Begin geladen
+                    refreshFingerMeta(fingerIndex);
+                    m = fingerMetaOf(fingerIndex);
+                }
+                ESP_LOGI(TAG, "Fingerprint detected successfully: fingerIndex=%d, schedule=%d actionIndex=%d", fingerIndex, m.schedule.index, m.actionIndex);
+                if (m.known && scheduler->GetCurrentValue(m.schedule)>0){
+                    handler->HandleFingerprintAction(fingerIndex, m.actionIndex);
                 }
             }
         }
@@ -82,6 +141,7 @@ namespace fingerprint
             GOTO_ERROR_ON_ERROR(nvs_commit(this->nvsFingerName2FingerIndex), "nvs");
             GOTO_ERROR_ON_ERROR(nvs_commit(this->nvsFingerIndex2ActionIndex), "nvs");
             GOTO_ERROR_ON_ERROR(nvs_commit(this->nvsFingerIndex2SchedulerName), "nvs");
+            refreshFingerMeta(fingerIndex);
             ESP_LOGI(TAG, "'%s', Finger is stored in index %d", grow_fingerprint::enrollStep2description[step], fingerIndex);
             if(handler) handler->HandleEnrollmentUpdate(errorCode, step, fingerIndex, fingerName);   
             return;   
@@ -93,13 +153,13 @@ namespace fingerprint
 
         grow_fingerprint::RET Begin(gpio_num_t tx_host, gpio_num_t rx_host)
         {
-            mutex = xSemaphoreCreateMutex();
             auto ret = R503Pro::Begin(tx_host, rx_host);
             if(ret!=grow_fingerprint::RET::OK){
                 return ret;
             }
             //Die ganzen Parameter wurden intern im R503Pro::Begin bereits eingelesen und stehen jetzt zur verfügung
             auto params=this->GetAllParams();
+            clearFingerMeta();
             uint16_t fingerIndex = 0;
             for (uint8_t bi = 0; bi < 32; bi++) {
                 auto the_byte = params->libraryIndicesUsed[bi];
@@ -123,6 +183,7 @@ namespace fingerprint
                             ESP_LOGI(TAG, "Finger index %d got name '%s'", fingerIndex, fingerName);
            
                         }
+                        refreshFingerMeta(fingerIndex);
                     }
                     fingerIndex++;
                 }
@@ -219,6 +280,7 @@ namespace fingerprint
 
             nvs_erase_key(this->nvsFingerIndex2SchedulerName, fingerIndexAsString);
             RETURN_ERRORCODE_ON_ERROR(nvs_commit(this->nvsFingerIndex2SchedulerName), grow_fingerprint::RET::xNVS_NOT_AVAILABLE);
+            refreshFingerMeta(fingerIndex);
             return grow_fingerprint::RET::OK;
         }
 
@@ -240,6 +302,7 @@ namespace fingerprint
 
             RETURN_ERRORCODE_ON_ERROR(nvs_erase_all(this->nvsFingerIndex2SchedulerName), grow_fingerprint::RET::xNVS_NOT_AVAILABLE);
             RETURN_ERRORCODE_ON_ERROR(nvs_commit(this->nvsFingerIndex2SchedulerName), grow_fingerprint::RET::xNVS_NOT_AVAILABLE);
+            clearFingerMeta();
             ESP_LOGI(TAG, "Successfully deleted all Fingerprints on the sensor hardware and in flash");
             return grow_fingerprint::RET::OK;
         }
@@ -250,6 +313,7 @@ namespace fingerprint
             snprintf(fingerIndexAsString, 6, "%d", fingerIndex);
             RETURN_ERRORCODE_ON_ERROR(nvs_set_u16(this->nvsFingerIndex2ActionIndex, fingerIndexAsString, actionIndex), grow_fingerprint::RET::xNVS_NOT_AVAILABLE);
             RETURN_ERRORCODE_ON_ERROR(nvs_commit(this->nvsFingerIndex2ActionIndex), grow_fingerprint::RET::xNVS_NOT_AVAILABLE);
+            refreshFingerMeta(fingerIndex);
             ESP_LOGI(TAG, "Successfully stored finger action. index=%s action=%d", fingerIndexAsString, actionIndex);
             return grow_fingerprint::RET::OK;
         }
@@ -260,6 +324,7 @@ namespace fingerprint
             snprintf(fingerIndexAsString, 6, "%d", fingerIndex);
             RETURN_ERRORCODE_ON_ERROR(nvs_set_str(this->nvsFingerIndex2SchedulerName, fingerIndexAsString, schedulerName), grow_fingerprint::RET::xNVS_NOT_AVAILABLE);
             RETURN_ERRORCODE_ON_ERROR(nvs_commit(this->nvsFingerIndex2SchedulerName), grow_fingerprint::RET::xNVS_NOT_AVAILABLE);
+            refreshFingerMeta(fingerIndex);
             //char schedulerNameRead[NVS_KEY_NAME_MAX_SIZE];
             //size_t s;
             //nvs_get_str(this->nvsFingerIndex2SchedulerName, fingerIndexAsString, schedulerNameRead, &s);
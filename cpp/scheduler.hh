@@ -6,8 +6,12 @@
 #include <cstdio>
 #include <memory>
 #include <map>
+#include <array>
+#include <algorithm>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "nvs_flash.h"
@@ -17,110 +21,690 @@
 #include <common.hh>
 #include "interfaces.hh"
 #include "scheduler_timers.hh"
+#include "scheduler_ephemeris.hh"
 #include "sunsetsunrise.hh"
 #include "webmanager_interfaces.hh"
 #define TAG "SCHEDULER"
 #include "esp_log.h"
 namespace scheduler
 {
+    // C++-Abonnenten (Subscribe) und Websocket-Abonnements (RequestSchedulerSubscribe) zusammen
+    constexpr size_t MAX_SUBSCRIBERS{16};
+
     class Scheduler : public webmanager::iWebmanagerPlugin, public webmanager::iScheduler
     {
     private:
         webmanager::iWebmanagerCallback *callback;
         nvs_handle_t nvsSchedulerHandle;
-        std::map<std::string, aTimer *> name2timer;
+        // Flache Timer-Tabelle, in die ScheduleHandle::index zeigt; ein freier Platz hat inUse==false.
+        // 'generation' wird beim Freigeben erhoeht, damit alte Handles ungueltig werden.
+        // Ein belegter Platz mit timer==nullptr ist nur indiziert: der Timer liegt noch (oder nach Verdraengung aus dem
+        // TimerPool bzw. nach einem Save wieder) nur in NVS unter 'key' und wird beim ersten Zugriff geladen (s. timerOf). 'type' merkt sich
+        // den ScheduleType fuer die Liste, ohne den Timer dafuer laden zu muessen (UNKNOWN_TYPE: noch nicht gelesen).
+        // Fuer abonnierte Timer (subscribers>0) zusaetzlich der zuletzt gemeldete Wert und der Zeitpunkt, ab dem
+        // er sich aendern kann -- das "Timer-Rad" in Loop ist nur das Minimum dieser Zeitpunkte (nextTransition).
+        static constexpr uint8_t UNKNOWN_TYPE{0xFF};
+        struct TimerSlot
+        {
+            aTimer *timer;
+            uint16_t generation;
+            bool inUse;
+            uint8_t type;
+            uint8_t subscribers;
+            uint16_t notifiedValue;
+            time_t due;
+            uint32_t lastUse;
+            char key[NVS_KEY_NAME_MAX_SIZE];
+        };
+        // genau eines von fn (C++) und session (Websocket-Tab) ist gesetzt; beide nullptr: Eintrag frei.
+        // Die Session-Objekte werden fuer neue Tabs wiederverwendet, deshalb zaehlt erst session zusammen mit
+        // sessionId (GetSessionId beim Abonnieren); weicht sie ab, ist der abonnierende Tab laengst geschlossen.
+        struct Subscriber
+        {
+            webmanager::ScheduleHandle handle;
+            webmanager::ScheduleChangedFn fn;
+            void *ctx;
+            webmanager::iWebmanagerCallback *session;
+            uint32_t sessionId;
+        };
+        std::vector<TimerSlot> slots;
+        // nur fuer ResolveSchedule und die (nach Namen sortierte) Liste an den Browser; std::less<> erlaubt
+        // find(const char*) ohne temporaeren std::string
+        std::map<std::string, uint16_t, std::less<>> name2slot;
         uint32_t julianDay{0};
+        Ephemeris ephemeris;
+        std::array<Subscriber, MAX_SUBSCRIBERS> subscribers{};
+        time_t nextTransition{NO_CHANGE};
+        // Schedule-Edits eines Requests werden in NVS nur vorgemerkt (nvs_set_blob/nvs_erase_key) und am Ende mit
+        // EINEM nvs_commit festgeschrieben, s. stageBlob/stageErase/commitStaged
+        size_t nvsStaged{0};
+        esp_err_t nvsStageError{ESP_OK};
+        uint32_t useClock{0};
+        // Der Scheduler wird aus mehreren Tasks benutzt: Loop aus dem Task der Anwendung, GetCurrentValue z.B. aus
+        // dem Fingerprint-Task, alle Websocket-Requests aus dem httpd-Task. Jeder davon kann einen Timer laden und
+        // dafuer einen anderen aus dem TimerPool verdraengen (delete), Save haengt Plaetze an 'slots' an (realloc).
+        // Deshalb schuetzt dieser (rekursive) Mutex ALLES: slots, name2slot, subscribers, die Timer selbst und das
+        // NVS-Staging. Alle private-Methoden setzen voraus, dass der Aufrufer ihn haelt; die public-Methoden nehmen
+        // ihn selbst. C++-Abonnenten (ScheduleChangedFn) werden nie mit gehaltenem Mutex aufgerufen.
+        SemaphoreHandle_t mutex{nullptr};
 
-    public:
-        Scheduler(nvs_handle_t nvsSchedulerHandle) : nvsSchedulerHandle(nvsSchedulerHandle) {}
+        struct PendingNotification
+        {
+            Subscriber sub;
+            uint16_t value;
+        };
 
-        uint16_t GetCurrentValueOfSchedule(const char *schedulerName) override
+        void take()
         {
-            if (!this->name2timer.contains(std::string(schedulerName)))
-                return 0;
-            time_t currentTime;
+            xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        }
 
-            time(&currentTime); // Get the current time
-            return GetCurrentValueOfSchedule(schedulerName, currentTime);
+        void give()
+        {
+            xSemaphoreGiveRecursive(mutex);
+        }
+
+        uint16_t addSlot(const char *name)
+        {
+            uint16_t index = 0;
+            while (index < slots.size() && slots[index].inUse)
+                index++;
+            if (index == slots.size())
+                slots.push_back({});
+            TimerSlot &slot = slots[index];
+            uint16_t generation = slot.generation;
+            slot = {};
+            slot.generation = generation;
+            slot.inUse = true;
+            slot.type = UNKNOWN_TYPE;
+            std::strncpy(slot.key, name, sizeof(slot.key) - 1);
+            name2slot[name] = index;
+            return index;
+        }
+
+        uint16_t addTimer(aTimer *t)
+        {
+            uint16_t index = addSlot(t->GetName().c_str());
+            slots[index].timer = t;
+            slots[index].type = (uint8_t)t->GetScheduleType();
+            slots[index].lastUse = ++useClock;
+            return index;
+        }
+
+        // nur die in NVS gespeicherten Schedules, die Predefined-Singletons werden nie verdraengt
+        static bool isPooled(const TimerSlot &slot)
+        {
+            return slot.timer && slot.type != (uint8_t)WsProtocol::scheduler::ScheduleType::PREDEFINED;
         }
 
-        uint16_t GetCurrentValueOfSchedule(const char *schedulerName, time_t currentTime)
+        // Gibt den am laengsten nicht benutzten geladenen Timer frei, der sich verlustfrei aus NVS neu laden laesst:
+        // ohne Abonnenten (Loop braucht deren Zustand) und kein SunRandomTimer (der wuerfelt beim Neuladen neu).
+        bool evictOne()
         {
+            TimerSlot *victim{nullptr};
+            for (auto &slot : slots)
+            {
+                if (!isPooled(slot) || slot.subscribers > 0 || slot.type != (uint8_t)WsProtocol::scheduler::ScheduleType::ONE_WEEK_IN_15_MINUTES)
+                    continue;
+                if (!victim || slot.lastUse < victim->lastUse)
+                    victim = &slot;
+            }
+            if (!victim)
+                return false;
+            ESP_LOGD(TAG, "Evicting schedule %s from RAM", victim->key);
+            delete victim->timer;
+            victim->timer = nullptr;
+            return true;
+        }
 
-            scheduler::aTimer *o = this->name2timer.at(std::string(schedulerName));
+        bool readSchedule(const char *key, uint8_t *blob, size_t &len, WsProtocol::scheduler::Schedule::Payload &schedule)
+        {
+            esp_err_t ret = nvs_get_blob(this->nvsSchedulerHandle, key, blob, &len);
+            if (ret != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Could not read schedule %s from nvs (%d)", key, ret);
+                return false;
+            }
+            size_t pos = 0;
+            return WsProtocol::scheduler::Schedule::Decode(blob, len, pos, schedule);
+        }
+
+        // laedt den Timer eines nur indizierten Platzes aus NVS in den TimerPool, verdraengt dafuer ggf. einen anderen
+        aTimer *materialize(TimerSlot &slot)
+        {
+            uint8_t blob[128];
+            size_t len{sizeof(blob)};
+            WsProtocol::scheduler::Schedule::Payload schedule{};
+            if (!readSchedule(slot.key, blob, len, schedule))
+                return nullptr;
+            // nur die Typen, aus denen Builder einen Timer im Pool anlegt; Predefined und kaputte Blobs liefern immer
+            // nullptr, dafuer einen gesunden Timer zu verdraengen waere vergebens
+            uint8_t type = scheduleTypeOf(schedule);
+            bool needsPoolBlock = type == (uint8_t)WsProtocol::scheduler::ScheduleType::ONE_WEEK_IN_15_MINUTES || type == (uint8_t)WsProtocol::scheduler::ScheduleType::SUN_RANDOM;
+            if (!needsPoolBlock)
+            {
+                ESP_LOGE(TAG, "Schedule %s has no loadable variant (type %u)", slot.key, (unsigned)type);
+                slot.type = type;
+                return nullptr;
+            }
+            aTimer *t = Builder::BuildFromSchedule(schedule);
+            if (!t && TimerPool::FreeBlocks() == 0 && evictOne())
+                t = Builder::BuildFromSchedule(schedule);
+            if (!t)
+            {
+                ESP_LOGE(TAG, "Could not load schedule %s (timer pool has %d free blocks)", slot.key, (int)TimerPool::FreeBlocks());
+                return nullptr;
+            }
+            if (this->julianDay != 0)
+            { // fuer SunRandom: den laufenden Tag nachholen, den Loop vor dem Laden schon begonnen hat
+                time_t sunriseUnixSecs{0};
+                time_t sunsetUnixSecs{0};
+                ephemeris.Lookup(this->julianDay, sunriseUnixSecs, sunsetUnixSecs);
+                t->NewDayHasBegun(this->julianDay, sunriseUnixSecs, sunsetUnixSecs);
+            }
+            slot.timer = t;
+            slot.type = (uint8_t)t->GetScheduleType();
+            return t;
+        }
+
+        // ScheduleType eines decodierten Schedules, ohne einen Timer anzulegen; UNKNOWN_TYPE, wenn die Variante fehlt
+        static uint8_t scheduleTypeOf(const WsProtocol::scheduler::Schedule::Payload &schedule)
+        {
+            uint8_t type{UNKNOWN_TYPE};
+            WsProtocol::scheduler::DecodeScheduleScheduleElements(schedule.scheduleData, schedule.scheduleDataSize, 1,
+                [&](auto &variant) {
+                    using T = std::decay_t<decltype(variant)>;
+                    if constexpr (std::is_same_v<T, WsProtocol::scheduler::OneWeekIn15Minutes::Payload>)
+                        type = (uint8_t)WsProtocol::scheduler::ScheduleType::ONE_WEEK_IN_15_MINUTES;
+                    else if constexpr (std::is_same_v<T, WsProtocol::scheduler::SunRandom::Payload>)
+                        type = (uint8_t)WsProtocol::scheduler::ScheduleType::SUN_RANDOM;
+                    else
+                        type = (uint8_t)WsProtocol::scheduler::ScheduleType::PREDEFINED;
+                });
+            return type;
+        }
+
+        // ScheduleType fuer die Liste; liest bei einem nie geladenen Schedule nur den Blob, ohne einen Timer anzulegen
+        uint8_t typeOf(TimerSlot &slot)
+        {
+            if (slot.type != UNKNOWN_TYPE)
+                return slot.type;
+            uint8_t blob[128];
+            size_t len{sizeof(blob)};
+            WsProtocol::scheduler::Schedule::Payload schedule{};
+            if (readSchedule(slot.key, blob, len, schedule))
+                slot.type = scheduleTypeOf(schedule);
+            return slot.type == UNKNOWN_TYPE ? (uint8_t)WsProtocol::scheduler::ScheduleType::PREDEFINED : slot.type;
+        }
+
+        void freeSlot(uint16_t index)
+        {
+            for (auto &sub : subscribers)
+                if (sub.handle.index == index && sub.handle.generation == slots[index].generation)
+                    sub = {};
+            if (isPooled(slots[index]))
+                delete slots[index].timer;
+            slots[index].timer = nullptr;
+            slots[index].inUse = false;
+            slots[index].generation++;
+            slots[index].subscribers = 0;
+        }
+
+        // wie GetCurrentValue(handle, t), liefert zusaetzlich, bis wann der Wert gilt
+        static uint16_t valueAt(aTimer *o, time_t currentTime, time_t &validUntil)
+        {
             if (currentTime > 1800 && currentTime < 1716498366L)
             { // Failsafe: If System runs for at least half an hour, but has no valid timestamp (constant is epoch time when writing this code)
+                validUntil = currentTime + 60;
                 return true;
             }
-            struct tm *localTime;
-            localTime = localtime(&currentTime); // Convert the current time to the local time
-            int day_of_week = localTime->tm_wday;
-            int h = localTime->tm_hour;
-            int m = localTime->tm_min;
-            int s = localTime->tm_sec;
-            uint16_t val = o->GetCurrentValue(currentTime, day_of_week, h, m, s);
-            ESP_LOGI(TAG, "On %d:%d:%d und weekday %d timer is %d", h, m, s, day_of_week, val);
+            uint16_t val = o->GetCachedValue(currentTime);
+            validUntil = o->GetCachedUntil();
             return val;
         }
+
+        esp_err_t addSubscriber(const Subscriber &newSub)
+        {
+            aTimer *o = timerOf(newSub.handle);
+            if (!o)
+                return ESP_ERR_NOT_FOUND;
+            TimerSlot &slot = slots[newSub.handle.index];
+            bool added{false};
+            for (auto &sub : subscribers)
+            {
+                if (sub.fn || sub.session)
+                    continue;
+                sub = newSub;
+                added = true;
+                break;
+            }
+            if (!added)
+            {
+                ESP_LOGW(TAG, "Subscriber table full (%d entries)", (int)MAX_SUBSCRIBERS);
+                return ESP_ERR_NO_MEM;
+            }
+            if (slot.subscribers++ == 0)
+            { // erster Abonnent: ab jetzt ueberwacht Loop diesen Timer
+                time_t now;
+                time(&now);
+                slot.notifiedValue = valueAt(o, now, slot.due);
+                nextTransition = std::min(nextTransition, slot.due);
+            }
+            return ESP_OK;
+        }
+
+        esp_err_t removeSubscriber(const Subscriber &match)
+        {
+            const webmanager::ScheduleHandle &handle = match.handle;
+            bool removed{false};
+            for (auto &sub : subscribers)
+            {
+                if (sub.handle.index != handle.index || sub.handle.generation != handle.generation || sub.fn != match.fn || sub.ctx != match.ctx || sub.session != match.session || sub.sessionId != match.sessionId)
+                    continue;
+                sub = {};
+                removed = true;
+                break;
+            }
+            if (!removed)
+                return ESP_ERR_NOT_FOUND;
+            if (isValid(handle))
+                slots[handle.index].subscribers--;
+            return ESP_OK;
+        }
+
+        // alle Abonnements eines Tabs, egal unter welcher sessionId (auch solche frueherer Tabs derselben Session)
+        void removeSessionSubscribers(webmanager::iWebmanagerCallback *session)
+        {
+            for (auto &sub : subscribers)
+            {
+                if (sub.session != session)
+                    continue;
+                if (isValid(sub.handle))
+                    slots[sub.handle.index].subscribers--;
+                sub = {};
+            }
+        }
+
+        esp_err_t sendNotify(webmanager::iWebmanagerCallback *session, webmanager::ScheduleHandle handle, uint16_t value)
+        {
+            aTimer *o = timerOf(handle);
+            if (!o)
+                return ESP_ERR_NOT_FOUND;
+            time_t nextChange = o->GetCachedUntil();
+            WsProtocol::scheduler::NotifyScheduleChanged::Payload n{};
+            std::string name = o->GetName();
+            n.name = name.c_str();
+            n.value = value;
+            n.nextChangeEpoch = nextChange == NO_CHANGE ? -1 : nextChange;
+            webmanager::PooledFrame *f = session->ReserveFrame(64);
+            if (!f)
+                return ESP_ERR_NO_MEM;
+            f->coalesceKey = handle.index;
+            size_t len = WsProtocol::scheduler::NotifyScheduleChanged::Encode(n, f->buffer, f->capacity);
+            return session->CommitFrame(f, len);
+        }
+
+        // Sammelt die Abonnenten aller Timer, deren Wert sich bis unixSecs geaendert hat, in 'pending' und bestimmt
+        // den naechsten faelligen Zeitpunkt. Zwischen zwei Wechseln kostet Loop damit nur einen Vergleich. Benachrichtigt
+        // wird erst nach dem Freigeben des Mutex (deliver), je Abonnent hoechstens einmal je Aufruf.
+        size_t collectTransitions(time_t unixSecs, std::array<PendingNotification, MAX_SUBSCRIBERS> &pending)
+        {
+            size_t count{0};
+            time_t next{NO_CHANGE};
+            for (uint16_t i = 0; i < slots.size(); i++)
+            {
+                TimerSlot &slot = slots[i];
+                if (!slot.inUse || slot.subscribers == 0)
+                    continue;
+                if (slot.due <= unixSecs)
+                {
+                    // nach einem Save ist der Platz nur indiziert, der abonnierte Timer wird hier neu geladen
+                    aTimer *t = slot.timer ? slot.timer : materialize(slot);
+                    if (!t)
+                    {
+                        slot.due = unixSecs + 60;
+                        next = std::min(next, slot.due);
+                        continue;
+                    }
+                    uint16_t value = valueAt(t, unixSecs, slot.due);
+                    if (value != slot.notifiedValue)
+                    {
+                        slot.notifiedValue = value;
+                        for (auto &sub : subscribers)
+                            if ((sub.fn || sub.session) && sub.handle.index == i && sub.handle.generation == slot.generation)
+                                pending[count++] = {sub, value};
+                    }
+                }
+                next = std::min(next, slot.due);
+            }
+            nextTransition = next;
+            return count;
+        }
+
+        // ohne gehaltenen Mutex aufrufen
+        void deliver(const std::array<PendingNotification, MAX_SUBSCRIBERS> &pending, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                const Subscriber &sub = pending[i].sub;
+                if (sub.fn)
+                {
+                    sub.fn(sub.ctx, sub.handle, pending[i].value);
+                    continue;
+                }
+                take();
+                if (sub.session->GetSessionId() != sub.sessionId || sendNotify(sub.session, sub.handle, pending[i].value) == ESP_ERR_INVALID_STATE)
+                { // Tab geschlossen (die Session gehoert ggf. schon einem anderen Tab)
+                    removeSubscriber(sub);
+                }
+                give();
+            }
+        }
+
+        bool isValid(webmanager::ScheduleHandle handle) const
+        {
+            return handle.index < slots.size() && slots[handle.index].inUse && slots[handle.index].generation == handle.generation;
+        }
+
+        // laedt den Timer bei Bedarf aus NVS nach
+        aTimer *timerOf(webmanager::ScheduleHandle handle)
+        {
+            if (!isValid(handle))
+                return nullptr;
+            TimerSlot &slot = slots[handle.index];
+            slot.lastUse = ++useClock;
+            return slot.timer ? slot.timer : materialize(slot);
+        }
+
+        void stageErase(const char *name)
+        {
+            esp_err_t ret = nvs_erase_key(this->nvsSchedulerHandle, name);
+            if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND)
+                nvsStageError = ret;
+            nvsStaged++;
+        }
+
+        // liefert den ersten Fehler seit dem letzten Commit
+        esp_err_t commitStaged()
+        {
+            esp_err_t ret = nvsStageError;
+            if (nvsStaged > 0)
+            {
+                esp_err_t commitRet = nvs_commit(this->nvsSchedulerHandle);
+                if (ret == ESP_OK)
+                    ret = commitRet;
+                ESP_LOGI(TAG, "Committed %d schedule changes to nvs (%d)", (int)nvsStaged, ret);
+            }
+            nvsStaged = 0;
+            nvsStageError = ESP_OK;
+            return ret;
+        }
+
+        void stageBlob(const char *name, const uint8_t *blob, size_t len)
+        {
+            esp_err_t ret = len > 0 ? nvs_set_blob(this->nvsSchedulerHandle, name, blob, len) : ESP_ERR_INVALID_SIZE;
+            if (ret != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Could not write schedule %s to nvs (%d)", name, ret);
+                nvsStageError = ret;
+            }
+            nvsStaged++;
+        }
+
+        // Legt ein Schedule an oder ersetzt das gleichnamige; schreibt nach NVS, committet aber nicht. Gebaut wird
+        // dabei kein Timer: der Blob geht direkt nach NVS, der Platz bleibt nur indiziert und wird beim naechsten
+        // Zugriff geladen (timerOf). Ein gerade voller TimerPool kann so weder ein Speichern verhindern noch ein
+        // vorhandenes Schedule verlieren. false, wenn das Schedule nicht uebernommen wurde.
+        bool applySave(const WsProtocol::scheduler::Schedule::Payload &schedule)
+        {
+            uint8_t type = scheduleTypeOf(schedule);
+            if (type != (uint8_t)WsProtocol::scheduler::ScheduleType::ONE_WEEK_IN_15_MINUTES && type != (uint8_t)WsProtocol::scheduler::ScheduleType::SUN_RANDOM)
+            {
+                ESP_LOGW(TAG, "Schedule %s has no storable schedule variant", schedule.name);
+                return false;
+            }
+            if (std::strlen(schedule.name) == 0 || std::strlen(schedule.name) >= NVS_KEY_NAME_MAX_SIZE)
+            {
+                ESP_LOGW(TAG, "Schedule name '%s' is not a valid nvs key", schedule.name);
+                return false;
+            }
+            auto it = this->name2slot.find(schedule.name);
+            if (it != this->name2slot.end() && slots[it->second].type == (uint8_t)WsProtocol::scheduler::ScheduleType::PREDEFINED)
+            {
+                ESP_LOGW(TAG, "%s is a predefined schedule and cannot be overwritten", schedule.name);
+                return false;
+            }
+            uint8_t blob[128];
+            size_t len = WsProtocol::scheduler::Schedule::Encode(schedule, blob, 0, sizeof(blob));
+            esp_err_t errorBefore = nvsStageError;
+            stageBlob(schedule.name, blob, len); // nvs_set_blob ueberschreibt einen vorhandenen Eintrag, ein vorheriges Loeschen entfaellt
+            if (nvsStageError != errorBefore || len == 0)
+                return false;
+            if (it != this->name2slot.end())
+            {
+                ESP_LOGI(TAG, "%s is an existing schedule --> replace it in flash, reload on next use", schedule.name);
+                // gleicher Platz: Handles auf das alte Schedule gelten fuer das neue weiter
+                TimerSlot &slot = slots[it->second];
+                if (isPooled(slot))
+                    delete slot.timer;
+                slot.timer = nullptr;
+                slot.type = type;
+                slot.due = 0;
+                nextTransition = 0;
+            }
+            else
+            {
+                slots[addSlot(schedule.name)].type = type;
+            }
+            return true;
+        }
+
+        void newDayHasBegun(uint32_t newJulianDay)
+        {
+            this->julianDay = newJulianDay;
+            time_t sunriseUnixSecs{0};
+            time_t sunsetUnixSecs{0};
+            ephemeris.Lookup(this->julianDay, sunriseUnixSecs, sunsetUnixSecs);
+            ESP_LOGI(TAG, "A new julian day %lu has begun. sunrise %lld, sunset %lld", (unsigned long)julianDay, (long long)sunriseUnixSecs, (long long)sunsetUnixSecs);
+            for (auto &slot : slots)
+            {
+                if (!slot.timer)
+                    continue;
+                slot.timer->NewDayHasBegun(julianDay, sunriseUnixSecs, sunsetUnixSecs);
+                slot.timer->InvalidateCache();
+                slot.due = 0;
+            }
+            nextTransition = 0;
+        }
+
+    public:
+        Scheduler(nvs_handle_t nvsSchedulerHandle) : nvsSchedulerHandle(nvsSchedulerHandle)
+        {
+            mutex = xSemaphoreCreateRecursiveMutex();
+        }
+
+        uint16_t GetCurrentValueOfSchedule(const char *schedulerName) override
+        {
+            take();
+            uint16_t value = GetCurrentValue(ResolveSchedule(schedulerName));
+            give();
+            return value;
+        }
+
+        webmanager::ScheduleHandle ResolveSchedule(const char *schedulerName) override
+        {
+            webmanager::ScheduleHandle handle{webmanager::INVALID_SCHEDULE_HANDLE};
+            take();
+            auto it = this->name2slot.find(schedulerName);
+            if (it != this->name2slot.end())
+                handle = {it->second, slots[it->second].generation};
+            give();
+            return handle;
+        }
+
+        bool IsValid(webmanager::ScheduleHandle handle) override
+        {
+            take();
+            bool valid = isValid(handle);
+            give();
+            return valid;
+        }
+
+        esp_err_t Subscribe(webmanager::ScheduleHandle handle, webmanager::ScheduleChangedFn fn, void *ctx) override
+        {
+            if (!fn)
+                return ESP_ERR_INVALID_ARG;
+            take();
+            esp_err_t ret = addSubscriber({handle, fn, ctx, nullptr, 0});
+            give();
+            if (ret == ESP_OK)
+                fn(ctx, handle, GetCurrentValue(handle));
+            return ret;
+        }
+
+        esp_err_t Unsubscribe(webmanager::ScheduleHandle handle, webmanager::ScheduleChangedFn fn, void *ctx) override
+        {
+            take();
+            esp_err_t ret = removeSubscriber({handle, fn, ctx, nullptr, 0});
+            give();
+            return ret;
+        }
+
+        // Standort fuer Sonnenauf-/-untergang, typischerweise aus den Usersettings der Anwendung (Mikrograd, passt in
+        // ein IntegerSetting). Wirkt mit dem naechsten Loop-Aufruf, der den Tag samt SunRandom-Timern neu berechnet.
+        void SetLocation(int32_t latitudeMicroDeg, int32_t longitudeMicroDeg)
+        {
+            take();
+            ephemeris.SetLocation(latitudeMicroDeg, longitudeMicroDeg);
+            this->julianDay = 0;
+            give();
+        }
+
+        // Zeitpunkt, bis zu dem Loop sicher keinen Wertwechsel eines abonnierten Schedules melden wird; der Aufrufer
+        // kann bis dahin (bzw. bis zum naechsten Tageswechsel) schlafen
+        time_t GetNextTransition()
+        {
+            take();
+            time_t next = nextTransition;
+            give();
+            return next;
+        }
+
+        uint16_t GetCurrentValue(webmanager::ScheduleHandle handle) override
+        {
+            time_t currentTime;
+            time(&currentTime); // Get the current time
+            return GetCurrentValue(handle, currentTime);
+        }
+
+        // Zwischen zwei Wertwechseln eines Timers nur ein Vergleich (s. aTimer::GetCachedValue)
+        uint16_t GetCurrentValue(webmanager::ScheduleHandle handle, time_t currentTime)
+        {
+            take();
+            scheduler::aTimer *o = timerOf(handle);
+            uint16_t value{0};
+            if (o && currentTime > 1800 && currentTime < 1716498366L)
+            { // Failsafe: If System runs for at least half an hour, but has no valid timestamp (constant is epoch time when writing this code)
+                value = true;
+            }
+            else if (o)
+            {
+                value = o->GetCachedValue(currentTime);
+            }
+            give();
+            return value;
+        }
+
         void Begin()
         {
-            name2timer.clear();
-            name2timer[ALWAYS.GetName()] = &ALWAYS;
-            name2timer[NEVER.GetName()] = &NEVER,
-            name2timer[DAILY_6_22.GetName()] = &DAILY_6_22;
-            name2timer[WORKING_DAYS_7_18.GetName()] = &WORKING_DAYS_7_18;
-            name2timer[TestEvenMinutesOnOddMinutesOff.GetName()] = &TestEvenMinutesOnOddMinutesOff;
+            take();
+            int64_t startUs = esp_timer_get_time();
+            for (uint16_t i = 0; i < slots.size(); i++)
+                if (slots[i].inUse)
+                    freeSlot(i);
+            name2slot.clear();
+            addTimer(&ALWAYS);
+            addTimer(&NEVER);
+            addTimer(&DAILY_6_22);
+            addTimer(&WORKING_DAYS_7_18);
+            addTimer(&TestEvenMinutesOnOddMinutesOff);
             nvs_iterator_t it = nullptr;
             esp_err_t res = nvs_entry_find_in_handle(this->nvsSchedulerHandle, NVS_TYPE_BLOB, &it);
             while (res == ESP_OK)
             {
                 nvs_entry_info_t info;
                 nvs_entry_info(it, &info); // Can omit error check if parameters are guaranteed to be non-NULL
-                size_t length{0};
-                nvs_get_blob(this->nvsSchedulerHandle, info.key, nullptr, &length);
-                uint8_t data[length];
-                nvs_get_blob(this->nvsSchedulerHandle, info.key, data, &length);
-                WsProtocol::scheduler::Schedule::Payload schedule{};
-                size_t pos = 0;
-                if (WsProtocol::scheduler::Schedule::Decode(data, length, pos, schedule))
-                {
-                    aTimer *t = Builder::BuildFromSchedule(schedule);
-                    if (t) this->name2timer[t->GetName()] = t;
-                }
+                // nur indizieren, geladen wird beim ersten Zugriff (timerOf)
+                if (!this->name2slot.contains(info.key))
+                    addSlot(info.key);
                 res = nvs_entry_next(&it);
             }
             nvs_release_iterator(it);
+            ESP_LOGI(TAG, "Indexed %d schedules in %lldus", (int)this->name2slot.size(), (long long)(esp_timer_get_time() - startUs));
+            give();
         }
 
         esp_err_t Loop(time_t unixSecs)
         {
-
+            std::array<PendingNotification, MAX_SUBSCRIBERS> pending;
+            size_t count{0};
+            take();
             uint32_t newJulianDay = sunsetsunrise::JulianDate(unixSecs);
-            if (newJulianDay == this->julianDay)
-                return ESP_OK;
-            this->julianDay = newJulianDay;
-            double latDeg = 52.0965;
-            double lonDeg = 7.6171;
-            time_t sunriseUnixSecs{0};
-            time_t sunsetUnixSecs{0};
-            sunsetsunrise::NextSunriseAndSunset<double>(this->julianDay, latDeg, lonDeg, sunsetsunrise::eDawn::CIVIL, sunriseUnixSecs, sunsetUnixSecs);
-            ESP_LOGI(TAG, "A new julian day %lu has begun. sunrise %lld, sunset %lld", julianDay, sunriseUnixSecs, sunsetUnixSecs);
-            for (auto const &[key, val] : name2timer)
+            if (newJulianDay != this->julianDay)
+                newDayHasBegun(newJulianDay);
+            if (unixSecs >= nextTransition)
+                count = collectTransitions(unixSecs, pending);
+            give();
+            deliver(pending, count);
+            return ESP_OK;
+        }
+
+        void FillAvailableScheduleNames(std::vector<std::string> &names) override
+        {
+            take();
+            for (auto const &[key, index] : name2slot)
             {
-                val->NewDayHasBegun(julianDay, sunriseUnixSecs, sunsetUnixSecs);
+                names.push_back(key);
             }
-            return ESP_OK;
+            give();
+        }
+
+        void OnBegin(webmanager::iWebmanagerCallback *callback) override
+        {
+            // ein neuerer Zustand desselben Schedules (coalesceKey = Index in der Timer-Tabelle) ersetzt einen noch nicht gesendeten
+            callback->SetSendPolicy(WsProtocol::scheduler::NAMESPACE_ID, WsProtocol::scheduler::NotifyScheduleChanged::TYPE_ID, webmanager::eSendPolicy::COALESCE_LATEST);
+        }
+        void OnSessionClosed(webmanager::iWebmanagerCallback *session) override
+        {
+            take();
+            removeSessionSubscribers(session);
+            give();
+        }
+        void OnWifiConnect(webmanager::iWebmanagerCallback*) override{}
+        void OnWifiDisconnect(webmanager::iWebmanagerCallback*)override{}
+        void OnTimeUpdate(webmanager::iWebmanagerCallback*)override{}
+        uint16_t GetNamespaceId() override { return WsProtocol::scheduler::NAMESPACE_ID; }
+        webmanager::eMessageReceiverResult ProvideWebsocketMessage(webmanager::iWebmanagerCallback *callback, httpd_req_t *req, httpd_ws_frame_t *ws_pkt, uint16_t namespaceId, uint16_t messageTypeId, const uint8_t *frame, size_t frameLen) override
+        {
+            if (namespaceId != WsProtocol::scheduler::NAMESPACE_ID)
+                return webmanager::eMessageReceiverResult::NOT_FOR_ME;
+            take();
+            webmanager::eMessageReceiverResult res = handleRequest(callback, messageTypeId, frame, frameLen);
+            give();
+            return res;
         }
 
+    private:
+        // alle handleRequest*: nur aus ProvideWebsocketMessage, also mit gehaltenem Mutex
         webmanager::eMessageReceiverResult handleRequestOpen(webmanager::iWebmanagerCallback *callback, const WsProtocol::scheduler::RequestSchedulerOpen::Payload &req)
         {
-            if (!this->name2timer.contains(req.name))
+            scheduler::aTimer *o = timerOf(ResolveSchedule(req.name));
+            if (!o)
             {
                 ESP_LOGW(TAG, "Did not found scheduler '%s' in local database", req.name);
                 return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
             }
             ESP_LOGI(TAG, "Send ResponseSchedulerOpen for '%s' back to browser", req.name);
-            scheduler::aTimer *o = this->name2timer.at(req.name);
 
             uint8_t variant_scratch[128];
             size_t variantLen = o->EncodeScheduleVariant(variant_scratch, 0, sizeof(variant_scratch));
@@ -142,24 +726,16 @@ namespace scheduler
             return (len > 0 && callback->SendRawAsync(buf, len) == ESP_OK) ? webmanager::eMessageReceiverResult::OK : webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
         }
 
-        void FillAvailableScheduleNames(std::vector<std::string> &names) override
-        {
-            for (auto const &[key, val] : name2timer)
-            {
-                names.push_back(key);
-            }
-        }
-
         webmanager::eMessageReceiverResult handleRequestList(webmanager::iWebmanagerCallback *callback, uint16_t requestId)
         {
             static uint8_t items_scratch[64 * 40];
             size_t items_pos = 0;
             size_t items_count = 0;
-            for (auto const &[key, val] : name2timer)
+            for (auto const &[key, index] : name2slot)
             {
                 WsProtocol::scheduler::SchedulerListItem::Payload item{};
                 item.name = key.c_str();
-                item.type = val->GetScheduleType();
+                item.type = (WsProtocol::scheduler::ScheduleType)typeOf(slots[index]);
                 size_t newPos = WsProtocol::scheduler::AppendResponseSchedulerListItemsSchedulerListItemElement(item, items_scratch, items_pos, sizeof(items_scratch));
                 if (newPos > 0) { items_pos = newPos; items_count++; }
             }
@@ -170,76 +746,107 @@ namespace scheduler
             resp.itemsCount = items_count;
             resp.itemsDataSize = items_pos;
 
-            static uint8_t buf[4096];
-            size_t len = WsProtocol::scheduler::ResponseSchedulerList::Encode(resp, buf, sizeof(buf));
-            return (len > 0 && callback->SendRawAsync(buf, len) == ESP_OK) ? webmanager::eMessageReceiverResult::OK : webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            webmanager::PooledFrame *f = callback->ReserveFrame(items_pos + 64);
+            if (!f)
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            size_t len = WsProtocol::scheduler::ResponseSchedulerList::Encode(resp, f->buffer, f->capacity);
+            return callback->CommitFrame(f, len) == ESP_OK ? webmanager::eMessageReceiverResult::OK : webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
         }
 
         webmanager::eMessageReceiverResult handleRequestDelete(webmanager::iWebmanagerCallback *callback, const WsProtocol::scheduler::RequestSchedulerDelete::Payload &req)
         {
-            if (!this->name2timer.contains(req.name))
+            auto it = this->name2slot.find(req.name);
+            if (it == this->name2slot.end())
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            // erst festschreiben, dann aus dem RAM nehmen -- sonst waere ein Schedule, dessen Loeschen in NVS scheitert,
+            // bis zum naechsten Neustart verschwunden und kaeme danach wieder
+            stageErase(req.name);
+            if (commitStaged() != ESP_OK)
                 return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
-            this->name2timer.erase(req.name);
-            nvs_erase_key(this->nvsSchedulerHandle, req.name);
-            nvs_commit(this->nvsSchedulerHandle);
-            ESP_LOGI(TAG, "Successfully deleted fingerprint %s", req.name);
+            freeSlot(it->second);
+            this->name2slot.erase(it);
+            ESP_LOGI(TAG, "Successfully deleted schedule %s", req.name);
             return handleRequestList(callback, req.requestId);
         }
 
         webmanager::eMessageReceiverResult handleRequestRename(webmanager::iWebmanagerCallback *callback, const WsProtocol::scheduler::RequestSchedulerRename::Payload &req)
         {
-            if (!this->name2timer.contains(req.oldName))
+            auto it = this->name2slot.find(req.oldName);
+            if (it == this->name2slot.end())
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            if (this->name2slot.contains(req.newName))
                 return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
-            if (this->name2timer.contains(req.newName))
+            if (std::strlen(req.newName) == 0 || std::strlen(req.newName) >= NVS_KEY_NAME_MAX_SIZE)
                 return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
-            scheduler::aTimer *o = this->name2timer.at(req.oldName);
-            size_t max_size{128};
-            uint8_t blob[max_size];
-            o->RenameAndFillNvsBlob(req.newName, blob, max_size);
-            this->name2timer.erase(req.oldName);
-            this->name2timer[req.newName] = o;
-            nvs_erase_key(this->nvsSchedulerHandle, req.oldName);
-            nvs_set_blob(this->nvsSchedulerHandle, req.newName, blob, max_size);
-            nvs_commit(this->nvsSchedulerHandle);
-            ESP_LOGI(TAG, "Successfully renamed fingerprint %s to %s", req.oldName, req.newName);
+            // der Platz in der Timer-Tabelle bleibt, ausgegebene Handles zeigen weiter auf dieses Schedule
+            uint16_t index = it->second;
+            if (slots[index].type == (uint8_t)WsProtocol::scheduler::ScheduleType::PREDEFINED)
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            // umbenannt wird der NVS-Blob, ein nicht geladener Timer muss dafuer nicht in den TimerPool
+            uint8_t blob[128];
+            size_t len{sizeof(blob)};
+            WsProtocol::scheduler::Schedule::Payload schedule{};
+            if (!readSchedule(slots[index].key, blob, len, schedule))
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            schedule.name = req.newName;
+            uint8_t renamed[128];
+            size_t renamedLen = WsProtocol::scheduler::Schedule::Encode(schedule, renamed, 0, sizeof(renamed));
+            esp_err_t errorBefore = nvsStageError;
+            stageBlob(req.newName, renamed, renamedLen);
+            if (nvsStageError != errorBefore || renamedLen == 0)
+            {
+                commitStaged();
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            }
+            stageErase(req.oldName);
+            if (slots[index].timer)
+                slots[index].timer->Rename(req.newName);
+            std::strncpy(slots[index].key, req.newName, sizeof(slots[index].key) - 1);
+            this->name2slot.erase(it);
+            this->name2slot[req.newName] = index;
+            if (commitStaged() != ESP_OK)
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            ESP_LOGI(TAG, "Successfully renamed schedule %s to %s", req.oldName, req.newName);
             return handleRequestList(callback, req.requestId);
         }
 
         webmanager::eMessageReceiverResult handleRequestSave(webmanager::iWebmanagerCallback *callback, const WsProtocol::scheduler::RequestSchedulerSave::Payload &req)
         {
+            bool applied{true};
             bool ok = WsProtocol::scheduler::DecodeRequestSchedulerSavePayloadElements(req.payloadData, req.payloadDataSize, 1,
-                [&](auto &schedule) {
-                    std::string name = schedule.name;
-                    if (this->name2timer.contains(name))
-                    {
-                        ESP_LOGI(TAG, "%s is as existing fingerprint -->erase old in map and in flash", name.c_str());
-                        scheduler::aTimer *o = this->name2timer.at(name);
-                        this->name2timer.erase(name);
-                        nvs_erase_key(this->nvsSchedulerHandle, name.c_str());
-                        delete (o);
-                    }
-                    aTimer *t = Builder::BuildFromSchedule(schedule);
-                    if (!t) return;
-                    this->name2timer[name] = t;
-                    size_t max_size{128};
-                    uint8_t blob[max_size];
-                    t->FillNvsBlob(blob, max_size);
-                    nvs_set_blob(this->nvsSchedulerHandle, name.c_str(), blob, max_size);
-                    nvs_commit(this->nvsSchedulerHandle);
-                    ESP_LOGI(TAG, "Successfully saved fingerprint %s ", name.c_str());
-                });
+                [&](auto &schedule) { applied = applySave(schedule) && applied; });
+            ok = commitStaged() == ESP_OK && ok && applied;
             if (!ok) return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
             return handleRequestList(callback, req.requestId);
         }
 
-        void OnBegin(webmanager::iWebmanagerCallback*) override{}
-        void OnWifiConnect(webmanager::iWebmanagerCallback*) override{}
-        void OnWifiDisconnect(webmanager::iWebmanagerCallback*)override{}
-        void OnTimeUpdate(webmanager::iWebmanagerCallback*)override{}
-        webmanager::eMessageReceiverResult ProvideWebsocketMessage(webmanager::iWebmanagerCallback *callback, httpd_req_t *req, httpd_ws_frame_t *ws_pkt, uint16_t namespaceId, uint16_t messageTypeId, const uint8_t *frame, size_t frameLen) override
+        // Massenimport aus der UI: alle Schedules in einem Request, ein nvs_commit fuer alle
+        webmanager::eMessageReceiverResult handleRequestSaveBatch(webmanager::iWebmanagerCallback *callback, const WsProtocol::scheduler::RequestSchedulerSaveBatch::Payload &req)
+        {
+            // ein nicht uebernehmbares Schedule haelt die uebrigen nicht auf, die Antwort meldet aber den Fehler
+            bool applied{true};
+            bool ok = WsProtocol::scheduler::DecodeRequestSchedulerSaveBatchSchedulesElements(req.schedulesData, req.schedulesDataSize, req.schedulesCount,
+                [&](auto &schedule) { applied = applySave(schedule) && applied; });
+            ok = commitStaged() == ESP_OK && ok && applied;
+            ESP_LOGI(TAG, "Imported %d schedules", (int)req.schedulesCount);
+            if (!ok) return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            return handleRequestList(callback, req.requestId);
+        }
+
+        webmanager::eMessageReceiverResult handleRequestSubscribe(webmanager::iWebmanagerCallback *callback, const WsProtocol::scheduler::RequestSchedulerSubscribe::Payload &req)
+        {
+            webmanager::ScheduleHandle handle = ResolveSchedule(req.name);
+            Subscriber sub{handle, nullptr, nullptr, callback, callback->GetSessionId()};
+            if (!req.subscribe)
+                return removeSubscriber(sub) == ESP_OK ? webmanager::eMessageReceiverResult::OK : webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            if (addSubscriber(sub) != ESP_OK)
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            ESP_LOGI(TAG, "Websocket client subscribed to schedule '%s'", req.name);
+            return sendNotify(callback, handle, GetCurrentValue(handle)) == ESP_OK ? webmanager::eMessageReceiverResult::OK : webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+        }
+
+        webmanager::eMessageReceiverResult handleRequest(webmanager::iWebmanagerCallback *callback, uint16_t messageTypeId, const uint8_t *frame, size_t frameLen)
         {
-            if (namespaceId != WsProtocol::scheduler::NAMESPACE_ID)
-                return webmanager::eMessageReceiverResult::NOT_FOR_ME;
             switch (messageTypeId)
             {
             case WsProtocol::scheduler::RequestSchedulerList::TYPE_ID:
@@ -266,6 +873,18 @@ namespace scheduler
                 if (!WsProtocol::scheduler::RequestSchedulerSave::Decode(frame, frameLen, r)) return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
                 return handleRequestSave(callback, r);
             }
+            case WsProtocol::scheduler::RequestSchedulerSaveBatch::TYPE_ID:
+            {
+                WsProtocol::scheduler::RequestSchedulerSaveBatch::Payload r{};
+                if (!WsProtocol::scheduler::RequestSchedulerSaveBatch::Decode(frame, frameLen, r)) return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+                return handleRequestSaveBatch(callback, r);
+            }
+            case WsProtocol::scheduler::RequestSchedulerSubscribe::TYPE_ID:
+            {
+                WsProtocol::scheduler::RequestSchedulerSubscribe::Payload r{};
+                if (!WsProtocol::scheduler::RequestSchedulerSubscribe::Decode(frame, frameLen, r)) return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+                return handleRequestSubscribe(callback, r);
+            }
             case WsProtocol::scheduler::RequestSchedulerOpen::TYPE_ID:
             {
                 WsProtocol::scheduler::RequestSchedulerOpen::Payload r{};
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <array>
+#include "esp_timer.h"
+#include "sunsetsunrise.hh"
+#define TAG "SCHEDULER"
+#include "esp_log.h"
+namespace scheduler
+{
+    // Vorgabe, solange die Anwendung keinen Standort aus ihren Usersettings gesetzt hat (Muenster)
+    constexpr int32_t DEFAULT_LATITUDE_MICRODEG{52'096'500};
+    constexpr int32_t DEFAULT_LONGITUDE_MICRODEG{7'617'100};
+    constexpr size_t EPHEMERIS_DAYS{366};
+
+    // Sonnenauf- und -untergang fuer EPHEMERIS_DAYS aufeinanderfolgende julianische Tage eines Standorts. Die
+    // Fliesskomma-Rechnung (sunsetsunrise::NextSunriseAndSunset) laeuft einmal je Tag der Tabelle beim Build, also
+    // beim Start, bei Standortwechsel und einmal im Jahr -- Lookup ist reine Ganzzahl-Arithmetik, auch auf Targets
+    // ohne FPU. Gespeichert sind Sekunden relativ zu base + i*86400, damit passt ein Eintrag in 2x int32.
+    class Ephemeris
+    {
+    private:
+        struct Entry
+        {
+            int32_t sunriseOffset;
+            int32_t sunsetOffset;
+        };
+        std::array<Entry, EPHEMERIS_DAYS> days{};
+        uint32_t firstJulianDay{0};
+        time_t base{0};
+        bool valid{false};
+        int32_t latMicroDeg{DEFAULT_LATITUDE_MICRODEG};
+        int32_t lonMicroDeg{DEFAULT_LONGITUDE_MICRODEG};
+
+    public:
+        // verwirft die Tabelle; der naechste Lookup baut sie fuer den neuen Standort neu auf
+        void SetLocation(int32_t latitudeMicroDeg, int32_t longitudeMicroDeg)
+        {
+            latMicroDeg = latitudeMicroDeg;
+            lonMicroDeg = longitudeMicroDeg;
+            valid = false;
+        }
+
+        void Build(uint32_t fromJulianDay)
+        {
+            int64_t startUs = esp_timer_get_time();
+            double latDeg = latMicroDeg / 1e6;
+            double lonDeg = lonMicroDeg / 1e6;
+            for (size_t i = 0; i < EPHEMERIS_DAYS; i++)
+            {
+                time_t sunrise{0};
+                time_t sunset{0};
+                sunsetsunrise::NextSunriseAndSunset<double>(fromJulianDay + i, latDeg, lonDeg, sunsetsunrise::eDawn::CIVIL, sunrise, sunset);
+                if (i == 0)
+                    base = sunrise;
+                time_t dayBase = base + (time_t)i * 86400;
+                days[i] = {(int32_t)(sunrise - dayBase), (int32_t)(sunset - dayBase)};
+            }
+            firstJulianDay = fromJulianDay;
+            valid = true;
+            ESP_LOGI(TAG, "Built ephemeris for %lu days from julian day %lu at %ld/%ld udeg in %lldus", (unsigned long)EPHEMERIS_DAYS, (unsigned long)fromJulianDay, (long)latMicroDeg, (long)lonMicroDeg, (long long)(esp_timer_get_time() - startUs));
+        }
+
+        // O(1); baut die Tabelle nur neu auf, wenn julianDay ausserhalb liegt (Start, Standortwechsel, nach einem Jahr)
+        void Lookup(uint32_t julianDay, time_t &sunriseUnixSecs, time_t &sunsetUnixSecs)
+        {
+            if (!valid || julianDay < firstJulianDay || julianDay - firstJulianDay >= EPHEMERIS_DAYS)
+                Build(julianDay);
+            uint32_t i = julianDay - firstJulianDay;
+            time_t dayBase = base + (time_t)i * 86400;
+            sunriseUnixSecs = dayBase + days[i].sunriseOffset;
+            sunsetUnixSecs = dayBase + days[i].sunsetOffset;
+        }
+    };
+}
+#undef TAG
@@ -1,10 +1,14 @@
 #pragma once
 #include <cstdio>
 #include <ctime>
+#include <limits>
 #include <map>
 #include <vector>
 #include <string>
 #include <type_traits>
+#include <algorithm>
+#include <cstddef>
+#include "freertos/FreeRTOS.h"
 #include "wsprotocol_cpp/ws_protocol.hh"
 #include "esp_random.h"
 #include "sunsetsunrise.hh"
@@ -12,10 +16,63 @@
 #include "esp_log.h"
 namespace scheduler
 {
+    // nextChange-Wert fuer Timer, deren Wert sich nie (bzw. erst nach NewDayHasBegun) aendert
+    constexpr time_t NO_CHANGE{std::numeric_limits<time_t>::max()};
+
+    // Feste Speicherbloecke fuer die aus NVS geladenen bzw. vom Browser gespeicherten Timer (aTimer::operator new);
+    // der Scheduler haelt damit nie mehr als TIMER_POOL_BLOCKS Timer gleichzeitig im RAM und laedt bei Bedarf nach.
+    constexpr size_t TIMER_POOL_BLOCKS{16};
+    constexpr size_t TIMER_POOL_BLOCK_SIZE{256};
+
+    class TimerPool
+    {
+    private:
+        alignas(std::max_align_t) static inline uint8_t blocks[TIMER_POOL_BLOCKS][TIMER_POOL_BLOCK_SIZE];
+        static inline uint32_t usedMask{0};
+        static inline portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+        static_assert(TIMER_POOL_BLOCKS <= 32);
+
+    public:
+        static void *Allocate(size_t size)
+        {
+            if (size > TIMER_POOL_BLOCK_SIZE)
+                return nullptr;
+            void *p{nullptr};
+            portENTER_CRITICAL(&lock);
+            for (size_t i = 0; i < TIMER_POOL_BLOCKS; i++)
+            {
+                if (usedMask & (1u << i))
+                    continue;
+                usedMask |= 1u << i;
+                p = blocks[i];
+                break;
+            }
+            portEXIT_CRITICAL(&lock);
+            return p;
+        }
+
+        static void Free(void *p)
+        {
+            size_t i = ((uint8_t *)p - &blocks[0][0]) / TIMER_POOL_BLOCK_SIZE;
+            portENTER_CRITICAL(&lock);
+            usedMask &= ~(1u << i);
+            portEXIT_CRITICAL(&lock);
+        }
+
+        static size_t FreeBlocks()
+        {
+            return TIMER_POOL_BLOCKS - __builtin_popcount(usedMask);
+        }
+    };
+
     class aTimer
     {
     protected:
         std::string name;
+        // Cache fuer GetCachedValue: cachedValue gilt fuer cachedFrom <= t < cachedUntil
+        uint16_t cachedValue{0};
+        time_t cachedFrom{0};
+        time_t cachedUntil{0};
     public:
         std::string GetName(){
             return name;
@@ -24,8 +81,57 @@ namespace scheduler
 
         virtual ~aTimer(){}
 
+        // noexcept: bei erschoepftem Pool liefert 'new' nullptr (ohne Konstruktoraufruf) statt einer Exception
+        static void *operator new(size_t size) noexcept
+        {
+            return TimerPool::Allocate(size);
+        }
+
+        static void operator delete(void *p) noexcept
+        {
+            if (p)
+                TimerPool::Free(p);
+        }
+
         virtual uint16_t GetCurrentValue(time_t unixSecs, int d, int h, int m, int s) const = 0;
 
+        // Wert zum Zeitpunkt unixSecs plus Zeitpunkt der naechsten moeglichen Aenderung (> unixSecs); bis dahin liefert
+        // GetCurrentValue garantiert denselben Wert. Die Basisfassung passt fuer jeden Timer, der nur von Wochentag,
+        // Stunde und Minute abhaengt (naechste volle Minute); die Unterklassen wissen es meist genauer.
+        virtual uint16_t GetValueAndNextChange(time_t unixSecs, const struct tm &local, time_t &nextChange) const
+        {
+            nextChange = unixSecs - local.tm_sec + 60;
+            return GetCurrentValue(unixSecs, local.tm_wday, local.tm_hour, local.tm_min, local.tm_sec);
+        }
+
+        // Wie GetCurrentValue, aber zwischen zwei Wertwechseln nur ein Vergleich -- ohne localtime und virtuellen
+        // Aufruf. Ein Zurueckstellen der Uhr (SNTP) faellt aus dem gueltigen Bereich und rechnet neu.
+        uint16_t GetCachedValue(time_t unixSecs)
+        {
+            if (unixSecs >= cachedFrom && unixSecs < cachedUntil)
+                return cachedValue;
+            struct tm local;
+            localtime_r(&unixSecs, &local);
+            time_t nextChange;
+            cachedValue = GetValueAndNextChange(unixSecs, local, nextChange);
+            cachedFrom = unixSecs;
+            cachedUntil = nextChange;
+            ESP_LOGD(TAG, "Timer %s is %u on %d:%02d:%02d weekday %d, next change in %llds", name.c_str(), (unsigned)cachedValue, local.tm_hour, local.tm_min, local.tm_sec, local.tm_wday, (long long)(nextChange == NO_CHANGE ? -1 : nextChange - unixSecs));
+            return cachedValue;
+        }
+
+        // Ende des Gueltigkeitsbereichs des zuletzt von GetCachedValue gelieferten Werts (NO_CHANGE: unbegrenzt)
+        time_t GetCachedUntil() const
+        {
+            return cachedUntil;
+        }
+
+        // nach NewDayHasBegun bzw. wenn sich die Zeitzone geaendert hat
+        void InvalidateCache()
+        {
+            cachedUntil = 0;
+        }
+
         static aTimer* BuildFromBlob(uint8_t* data){return nullptr;}
 
         virtual void NewDayHasBegun(uint32_t julianDay, tms_t todaysSunrise, tms_t  todaysSunset){return;}
@@ -39,9 +145,8 @@ namespace scheduler
         // (NVS-Blob vs. Message-Payload) unterschiedliche Puffer-Ziele haben.
         virtual size_t EncodeScheduleVariant(uint8_t* dest, size_t pos, size_t dest_size) const = 0;
 
-        void RenameAndFillNvsBlob(std::string newName, uint8_t* data, size_t& len_in_out){
+        void Rename(std::string newName){
             this->name=newName;
-            FillNvsBlob(data, len_in_out);
         }
 
         void FillNvsBlob(uint8_t* data, size_t& len_in_out){
@@ -85,6 +190,12 @@ namespace scheduler
         {
             return UINT16_MAX;
         }
+
+        uint16_t GetValueAndNextChange(time_t unixSecs, const struct tm &local, time_t &nextChange) const override
+        {
+            nextChange = NO_CHANGE;
+            return UINT16_MAX;
+        }
     } ALWAYS("ALWAYS");
 
     class cNEVER: public aPredefinedTimer
@@ -96,6 +207,12 @@ namespace scheduler
         {
             return 0;
         }
+
+        uint16_t GetValueAndNextChange(time_t unixSecs, const struct tm &local, time_t &nextChange) const override
+        {
+            nextChange = NO_CHANGE;
+            return 0;
+        }
     } NEVER("NEVER");
 
     class cDAILY_6_22: public aPredefinedTimer
@@ -107,6 +224,13 @@ namespace scheduler
         {
             return (h >= 6 && h < 22)?UINT16_MAX:0;
         }
+
+        // wechselt nur zur vollen Stunde
+        uint16_t GetValueAndNextChange(time_t unixSecs, const struct tm &local, time_t &nextChange) const override
+        {
+            nextChange = unixSecs - local.tm_min * 60 - local.tm_sec + 3600;
+            return GetCurrentValue(unixSecs, local.tm_wday, local.tm_hour, local.tm_min, local.tm_sec);
+        }
     } DAILY_6_22("DAILY_6_22");
 
     class cWORKING_DAYS_7_18: public aPredefinedTimer
@@ -120,6 +244,13 @@ namespace scheduler
                 return 0;
             return (h >= 7 && h < 18)?UINT16_MAX:0;
         }
+
+        // wechselt nur zur vollen Stunde
+        uint16_t GetValueAndNextChange(time_t unixSecs, const struct tm &local, time_t &nextChange) const override
+        {
+            nextChange = unixSecs - local.tm_min * 60 - local.tm_sec + 3600;
+            return GetCurrentValue(unixSecs, local.tm_wday, local.tm_hour, local.tm_min, local.tm_sec);
+        }
     } WORKING_DAYS_7_18("WORKING_DAYS_7_18");
 
 
@@ -134,17 +265,81 @@ namespace scheduler
         }
     } TestEvenMinutesOnOddMinutesOff("TestEvenOdd");
 
+    // Bit k (LSB zuerst) von data ist der k-te Viertelstunden-Slot der Woche ab Sonntag 00:00 Ortszeit
+    // (k = Wochentag*96 + Stunde*4 + Minute/15). Ausgewertet wird auf einem Sekunden-Offset in dieser Woche; die
+    // Suche nach dem naechsten Wechsel laeuft ueber 32-Bit-Worte (XOR mit dem aktuellen Wert, dann ctz) statt Slot fuer
+    // Slot, so dass der Cache in aTimer bis zum tatsaechlichen naechsten Wechsel gilt statt nur bis zur Viertelstunde.
     class OneWeekIn15MinutesTimer :public aTimer{
         private:
+        static constexpr uint32_t SLOT_SECS{15 * 60};
+        static constexpr size_t SLOTS{672};
+        static constexpr size_t WORDS{SLOTS / 32};
         std::array<uint8_t, 84> data;
+        std::array<uint32_t, WORDS> words;
+
+        bool slotIsOn(uint32_t slot) const
+        {
+            return (words[slot >> 5] >> (slot & 31)) & 1;
+        }
+
         public:
-        OneWeekIn15MinutesTimer(std::string name, std::array<uint8_t, 84> data):aTimer(name), data(data){}
+        static constexpr uint32_t SECONDS_PER_WEEK{7 * 24 * 3600};
+        static constexpr uint32_t NEVER_CHANGES{UINT32_MAX};
+
+        OneWeekIn15MinutesTimer(std::string name, std::array<uint8_t, 84> data):aTimer(name), data(data){
+            for (size_t w = 0; w < WORDS; w++)
+                words[w] = data[4 * w] | (data[4 * w + 1] << 8) | (data[4 * w + 2] << 16) | ((uint32_t)data[4 * w + 3] << 24);
+        }
+
+        static uint32_t WeekOffsetOf(const struct tm &local)
+        {
+            return local.tm_wday * 86400 + local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+        }
+
+        uint16_t GetValueAtWeekOffset(uint32_t weekSecs) const
+        {
+            return slotIsOn(weekSecs / SLOT_SECS) ? UINT16_MAX : 0;
+        }
+
+        // Sekunden von weekSecs bis zum naechsten Wertwechsel (ueber das Wochenende hinweg), NEVER_CHANGES bei
+        // durchgehend gleichem Plan. Hoechstens WORDS+1 Worte statt bis zu 672 Slots.
+        uint32_t SecondsToNextChange(uint32_t weekSecs) const
+        {
+            uint32_t slot = weekSecs / SLOT_SECS;
+            uint32_t invert = slotIsOn(slot) ? UINT32_MAX : 0;
+            uint32_t w = slot >> 5;
+            // Bits bis einschliesslich des aktuellen Slots ausblenden
+            uint32_t diff = (words[w] ^ invert) & ~(UINT32_MAX >> (31 - (slot & 31)));
+            for (uint32_t i = 0; i <= WORDS; i++)
+            {
+                if (diff)
+                {
+                    uint32_t next = ((w + i) << 5) + __builtin_ctz(diff); // >= SLOTS: bereits in der Folgewoche
+                    return (next - slot) * SLOT_SECS - weekSecs % SLOT_SECS;
+                }
+                diff = words[(w + i + 1) % WORDS] ^ invert;
+            }
+            return NEVER_CHANGES;
+        }
 
         uint16_t GetCurrentValue(time_t unixSecs, int d, int h, int m, int s) const override
         {
-            uint8_t twoHours=data[d*12+(h>>1)];
-            uint8_t fifteenMinutesSlot = 4*(h&1)+(m/15);
-            return (twoHours&(1<<fifteenMinutesSlot))?UINT16_MAX:0;
+            return slotIsOn(d * 96 + h * 4 + m / 15) ? UINT16_MAX : 0;
+        }
+
+        uint16_t GetValueAndNextChange(time_t unixSecs, const struct tm &local, time_t &nextChange) const override
+        {
+            uint32_t weekSecs = WeekOffsetOf(local);
+            uint32_t toNext = SecondsToNextChange(weekSecs);
+            nextChange = toNext == NEVER_CHANGES ? NO_CHANGE : unixSecs + toNext;
+            if (nextChange != NO_CHANGE)
+            { // der Offset rechnet in Ortszeit; liegt eine Sommer-/Winterzeit-Umstellung dazwischen, stuendlich neu ansetzen
+                struct tm atNext;
+                localtime_r(&nextChange, &atNext);
+                if (atNext.tm_isdst != local.tm_isdst)
+                    nextChange = std::min(nextChange, unixSecs + 3600);
+            }
+            return GetValueAtWeekOffset(weekSecs);
         }
 
         static aTimer* BuildFromWsProtocol(std::string name, const WsProtocol::scheduler::OneWeekIn15Minutes::Payload &owi15m){
@@ -200,6 +395,18 @@ namespace scheduler
             return (unixSecs>=todaysStart&& unixSecs<=todaysEnd)?UINT16_MAX:0;
         }
 
+        // haengt nur an todaysStart/todaysEnd; die aendern sich erst mit NewDayHasBegun, das den Cache verwirft
+        uint16_t GetValueAndNextChange(time_t unixSecs, const struct tm &local, time_t &nextChange) const override
+        {
+            if (unixSecs < todaysStart)
+                nextChange = todaysStart;
+            else if (unixSecs <= todaysEnd)
+                nextChange = todaysEnd + 1;
+            else
+                nextChange = NO_CHANGE;
+            return GetCurrentValue(unixSecs, 0, 0, 0, 0);
+        }
+
 
 
         void NewDayHasBegun(uint32_t julianDay, time_t todaysSunriseUnixSecs, time_t todaysSunsetUnixSecs) override{
@@ -213,6 +420,8 @@ namespace scheduler
         }
     };
 
+    static_assert(sizeof(OneWeekIn15MinutesTimer) <= TIMER_POOL_BLOCK_SIZE && sizeof(SunRandomTimer) <= TIMER_POOL_BLOCK_SIZE);
+
     class Builder{
         public:
         // Deckt (wie schon die vormalige Flatbuffers-Fassung) nur OneWeekIn15Minutes/SunRandom ab --
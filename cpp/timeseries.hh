@@ -1,17 +1,21 @@
 #pragma once
 #include <cstring>
+#include <cstddef>
 #include <ctime>
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <limits>
+#include <type_traits>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
-#include <freertos/timers.h>
 #include <esp_ota_ops.h>
 #include <esp_partition.h>
 #include <esp_timer.h>
 #include <esp_chip_info.h>
+#include <esp_system.h>
 #include <time.h>
 #include <common-esp32.hh>
 #include <esp_log.h>
@@ -33,6 +37,19 @@ namespace timeseries
     constexpr size_t SECTORS_1hour{4}; // 16k
     constexpr size_t SECTORS_1day_START{SECTORS_1hour_START + SECTORS_1hour};
     constexpr size_t SECTORS_1day{4}; // 16
+    constexpr size_t SECTORS_TOTAL{SECTORS_1day_START + SECTORS_1day}; // so viel wird per esp_partition_mmap eingeblendet
+    // garantierte Loeschzyklen je Sektor laut Datenblatt der ueblichen SPI-NOR-Flashs; Grundlage der Lebensdauerprognose
+    constexpr uint32_t FLASH_ERASE_ENDURANCE{100000};
+    constexpr size_t ERASE_COUNT_OFFSET_BYTES{48}; // FlashSector::eraseCount
+    constexpr size_t FLAGS_OFFSET_BYTES{56};       // FlashSector::flags
+    constexpr int64_t SECTOR_FLAG_RECORD_CHECKSUM{1}; // FlashSector::flags: jedem Datensatz folgt ein Pruefsummenbyte
+    // Groesse des RAM-Zwischenpuffers je Granularitaet; der tatsaechlich genutzte Teil steht in GranularityConfig::STAGING_SAMPLES
+    constexpr size_t MAX_STAGING_BYTES{288};
+    // Abtastung per esp_timer, die Flash-Arbeit macht ein eigener Task niedriger Prioritaet (s. M::Init)
+    constexpr size_t SAMPLE_QUEUE_LENGTH{16}; // ueberbrueckt einen Sektor-Erase bzw. eine lange Query auch bei 100ms-Abtastung
+    constexpr uint32_t WORKER_PRIORITY{2};
+    constexpr uint32_t WORKER_STACK_SIZE{4096};
+    constexpr uint32_t MIN_SAMPLE_PERIOD_MS{100};
 
     enum class Granularity:u8_t
     {
@@ -58,25 +75,449 @@ namespace timeseries
         size_t SECTOR_HEADER_SIZE_BYTES;
         ReadingFusionStrategy strategy;
         size_t HOW_MANY_READING_DO_I_NEED_FROM_PREVIOUS;
+        size_t STAGING_SAMPLES; // so viele Samples werden im RAM gesammelt und dann mit EINEM esp_partition_write geschrieben = maximaler Verlust bei Stromausfall
+        size_t SECONDS_PER_RECORD; // Abstand zweier Datensaetze; Zeitpunkt eines Datensatzes = Sektorkopf-Zeitstempel + Index * SECONDS_PER_RECORD
     };
 
-    struct FourSignals
+    // Kennung des Sampletyps im Sektorkopf, damit ein Leser (Query, Browser) die Datensaetze ohne Kenntnis der
+    // Template-Parameter des schreibenden Geraets interpretieren kann
+    enum class SampleType : uint8_t
     {
-        int16_t values[4];
+        INT16 = 0,
+        INT32 = 1,
+        FLOAT = 2,
     };
 
+    template <typename T>
+    struct SampleTraits;
+
+    template <>
+    struct SampleTraits<int16_t>
+    {
+        static constexpr SampleType TYPE{SampleType::INT16};
+        using Accumulator = int64_t;
+    };
+
+    template <>
+    struct SampleTraits<int32_t>
+    {
+        static constexpr SampleType TYPE{SampleType::INT32};
+        using Accumulator = int64_t;
+    };
+
+    template <>
+    struct SampleTraits<float>
+    {
+        static constexpr SampleType TYPE{SampleType::FLOAT};
+        using Accumulator = double;
+    };
+
+    template <typename T, size_t N>
+    struct Signals
+    {
+        T values[N];
+    };
+
+    // das bisherige, fest verdrahtete Format
+    using FourSignals = Signals<int16_t, 4>;
+
+    // Ein Kanal eines Datensatzes, wie ihn Query liefert -- unabhaengig vom Sampletyp als float. Bei RecordLayout::MEAN
+    // sind min, max und last gleich mean.
+    struct QueryValue
+    {
+        float mean;
+        float min;
+        float max;
+        float last;
+    };
+
+    // Laufende Aggregation fuer eine grobere Granularitaet: jedes Rohsample (10s) wird in O(1) eingerechnet,
+    // beim Rollover wird nur noch das Ergebnis geschrieben -- kein Zuruecklesen der feineren Samples aus dem Flash.
+    // Summe, Min und Max laufen immer ueber die Rohsamples, der Stundenmittelwert ist also exakt der Mittelwert
+    // der 360 10s-Werte und nicht der Mittelwert gerundeter Minutenmittelwerte.
+    template <typename T, size_t N>
+    struct RunningAggregate
+    {
+        using Accumulator = typename SampleTraits<T>::Accumulator;
+        Accumulator sum[N];
+        T min[N];
+        T max[N];
+        T last[N];
+        uint32_t count;
+
+        RunningAggregate() { Reset(); }
+
+        void Reset()
+        {
+            for (size_t j = 0; j < N; j++)
+            {
+                sum[j] = 0;
+                min[j] = std::numeric_limits<T>::max();
+                max[j] = std::numeric_limits<T>::lowest();
+                last[j] = 0;
+            }
+            count = 0;
+        }
+
+        void Add(const Signals<T, N> &s)
+        {
+            for (size_t j = 0; j < N; j++)
+            {
+                sum[j] += s.values[j];
+                min[j] = std::min(min[j], s.values[j]);
+                max[j] = std::max(max[j], s.values[j]);
+                last[j] = s.values[j];
+            }
+            count++;
+        }
+
+        // bei Ganzzahlen kaufmaennisch gerundeter Mittelwert; bei count==0 bleibt 'out' unveraendert
+        void Mean(Signals<T, N> *out) const
+        {
+            if (count == 0)
+                return;
+            for (size_t j = 0; j < N; j++)
+            {
+                if constexpr (std::is_floating_point_v<T>)
+                {
+                    out->values[j] = (T)(sum[j] / count);
+                }
+                else
+                {
+                    Accumulator half = (Accumulator)count / 2;
+                    out->values[j] = (T)((sum[j] >= 0 ? sum[j] + half : sum[j] - half) / (Accumulator)count);
+                }
+            }
+        }
+    };
+
+    // Format der Datensaetze eines Sektors, steht im Sektorkopf (FlashSector::recordLayout). Sektoren aus der Zeit
+    // vor der Versionierung haben dort noch 0xFF.. (=-1) und werden als MEAN gelesen.
+    enum class RecordLayout : uint8_t
+    {
+        MEAN = 0,              // gerundeter Mittelwert je Kanal (bei 4x int16 das bisherige FourSignals)
+        MEAN_MIN_MAX_LAST = 1, // zusaetzlich Minimum, Maximum und letzter Rohwert des Aggregationsintervalls (4-fache Groesse)
+    };
+
+    // Datensatz einer Granularitaet. Die Rohwerte (TEN_SECONDS) sind immer MEAN; fuer die Roll-up-Granularitaeten
+    // waehlt das Geraet das Layout per Template-Parameter von timeseries::M -- wer Spitzen fuer Alarm-Analysen braucht,
+    // zahlt die 4-fache Flash-Menge je Roll-up-Datensatz, alle anderen nicht.
+    template <RecordLayout L, typename T, size_t N>
+    struct Record;
+
+    template <typename T, size_t N>
+    struct Record<RecordLayout::MEAN, T, N>
+    {
+        Signals<T, N> mean;
+
+        static Record FromAggregate(const RunningAggregate<T, N> &a)
+        {
+            Record r;
+            a.Mean(&r.mean);
+            return r;
+        }
+
+        void Get(size_t channel, QueryValue *v) const
+        {
+            v->mean = v->min = v->max = v->last = (float)mean.values[channel];
+        }
+    };
+
+    template <typename T, size_t N>
+    struct Record<RecordLayout::MEAN_MIN_MAX_LAST, T, N>
+    {
+        Signals<T, N> mean;
+        Signals<T, N> min;
+        Signals<T, N> max;
+        Signals<T, N> last;
+
+        static Record FromAggregate(const RunningAggregate<T, N> &a)
+        {
+            Record r;
+            a.Mean(&r.mean);
+            for (size_t j = 0; j < N; j++)
+            {
+                r.min.values[j] = a.min[j];
+                r.max.values[j] = a.max[j];
+                r.last.values[j] = a.last[j];
+            }
+            return r;
+        }
+
+        void Get(size_t channel, QueryValue *v) const
+        {
+            v->mean = (float)mean.values[channel];
+            v->min = (float)min.values[channel];
+            v->max = (float)max.values[channel];
+            v->last = (float)last.values[channel];
+        }
+    };
+
+    static_assert(sizeof(Record<RecordLayout::MEAN, int16_t, 4>) == 8 && sizeof(Record<RecordLayout::MEAN_MIN_MAX_LAST, int16_t, 4>) == 32);
+
+    // Kodierung der Datensaetze eines Sektors, steht im Sektorkopf (FlashSector::codec); -1 = RAW
+    enum class SectorCodec : uint8_t
+    {
+        RAW = 0,          // Datensaetze unveraendert mit fester Groesse (wahlfreier Zugriff ueber den Index)
+        DELTA_VARINT = 1, // s. DeltaVarintCodec
+    };
+
+    // Was ein Sektor enthaelt; steht im Sektorkopf und wird von GranularityRuntime beim Anlegen des Sektors geschrieben
+    struct RecordFormat
+    {
+        RecordLayout layout;
+        size_t recordSize;
+        uint8_t channels;
+        SampleType sampleType;
+        SectorCodec codec;
+    };
+
+    // Langsame Signale (Temperatur, Feuchte) aendern sich von einem 10s-Wert zum naechsten um wenige LSB oder gar nicht,
+    // trotzdem kostet jeder Datensatz roh seine volle Groesse. DELTA_VARINT speichert je Datensatz:
+    //  - eine Maske der geaenderten Worte (ein Wort = ein T des Datensatzes) als LEB128-Varint von (Maske << 1). Das
+    //    unterste Bit ist damit immer 0, das erste Byte eines Datensatzes also nie 0xFF -- so ist das Ende der Daten
+    //    im Sektor (geloeschter Flash) ohne Zaehler erkennbar.
+    //  - fuer jedes geaenderte Wort die Differenz zum Vorgaenger, bei Ganzzahlen zig-zag-kodiert, bei float das XOR der
+    //    Bitmuster (nahe beieinanderliegende Werte haben gleiche obere Bits), jeweils als Varint.
+    // Unveraenderte Worte kosten also nichts, ein ganz unveraenderter Datensatz ein Byte. Jeder Sektor beginnt mit
+    // einem Vorgaenger aus lauter Nullen, ist also fuer sich dekodierbar. Der Preis: Datensaetze eines Sektors lassen
+    // sich nur noch der Reihe nach lesen.
+    struct DeltaVarintCodec
+    {
+        static constexpr size_t MAX_WORDS{63}; // die Maske muss um ein Bit geschoben in einen uint64_t passen
+
+        static constexpr size_t WordSize(const RecordFormat &f) { return f.sampleType == SampleType::INT16 ? 2 : 4; }
+        static constexpr size_t Words(const RecordFormat &f) { return f.recordSize / WordSize(f); }
+
+        static constexpr size_t MaxVarintSize(size_t bits) { return (bits + 6) / 7; }
+
+        // Obergrenze fuer die Groesse eines kodierten Datensatzes (fuer "passt noch in den Sektor/Puffer")
+        static constexpr size_t MaxEncodedSize(const RecordFormat &f)
+        {
+            return MaxVarintSize(Words(f) + 1) + Words(f) * MaxVarintSize(WordSize(f) * 8 + 1);
+        }
+
+        static size_t PutVarint(uint64_t v, uint8_t *out)
+        {
+            size_t n{0};
+            while (v >= 0x80)
+            {
+                out[n++] = (uint8_t)(v | 0x80);
+                v >>= 7;
+            }
+            out[n++] = (uint8_t)v;
+            return n;
+        }
+
+        // false, wenn der Varint nicht vor 'end' endet
+        static bool GetVarint(const uint8_t *&p, const uint8_t *end, uint64_t &v)
+        {
+            v = 0;
+            for (unsigned shift = 0; p < end && shift < 64; shift += 7)
+            {
+                uint8_t b = *p++;
+                v |= (uint64_t)(b & 0x7F) << shift;
+                if (!(b & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+        static uint32_t getWord(const uint8_t *rec, size_t i, size_t wordSize)
+        {
+            if (wordSize == 2)
+            {
+                uint16_t w;
+                memcpy(&w, rec + i * 2, 2);
+                return w;
+            }
+            uint32_t w;
+            memcpy(&w, rec + i * 4, 4);
+            return w;
+        }
+
+        static void setWord(uint8_t *rec, size_t i, size_t wordSize, uint32_t w)
+        {
+            if (wordSize == 2)
+            {
+                uint16_t w16 = (uint16_t)w;
+                memcpy(rec + i * 2, &w16, 2);
+                return;
+            }
+            memcpy(rec + i * 4, &w, 4);
+        }
+
+        static uint64_t diff(SampleType t, uint32_t prev, uint32_t cur)
+        {
+            switch (t)
+            {
+            case SampleType::INT16:
+            {
+                int32_t d = (int32_t)(int16_t)cur - (int32_t)(int16_t)prev;
+                return (uint64_t)(uint32_t)((d << 1) ^ (d >> 31));
+            }
+            case SampleType::INT32:
+            {
+                int64_t d = (int64_t)(int32_t)cur - (int64_t)(int32_t)prev;
+                return (uint64_t)((d << 1) ^ (d >> 63));
+            }
+            default:
+                return prev ^ cur;
+            }
+        }
+
+        static uint32_t undiff(SampleType t, uint32_t prev, uint64_t z)
+        {
+            if (t == SampleType::FLOAT)
+                return prev ^ (uint32_t)z;
+            int64_t d = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+            if (t == SampleType::INT16)
+                return (uint16_t)(int16_t)((int32_t)(int16_t)prev + d);
+            return (uint32_t)(int32_t)((int64_t)(int32_t)prev + d);
+        }
+
+        // kodiert 'cur' gegen 'prev' nach 'out' (mindestens MaxEncodedSize Bytes) und liefert die Laenge
+        static size_t Encode(const RecordFormat &f, const uint8_t *prev, const uint8_t *cur, uint8_t *out)
+        {
+            const size_t wordSize = WordSize(f);
+            uint64_t mask{0};
+            for (size_t i = 0; i < Words(f); i++)
+                if (getWord(prev, i, wordSize) != getWord(cur, i, wordSize))
+                    mask |= 1ULL << i;
+            size_t n = PutVarint(mask << 1, out);
+            for (size_t i = 0; i < Words(f); i++)
+                if (mask & (1ULL << i))
+                    n += PutVarint(diff(f.sampleType, getWord(prev, i, wordSize), getWord(cur, i, wordSize)), out + n);
+            return n;
+        }
+
+        // dekodiert einen Datensatz ab 'p' und ueberschreibt damit 'rec' (= bisher der Vorgaenger); liefert die Anzahl
+        // gelesener Bytes, 0 bei Datenende (0xFF) oder wenn der Datensatz nicht vollstaendig vor 'end' liegt
+        static size_t Decode(const RecordFormat &f, uint8_t *rec, const uint8_t *p, const uint8_t *end)
+        {
+            const uint8_t *start = p;
+            uint64_t mask;
+            if (p >= end || *p == 0xFF || !GetVarint(p, end, mask))
+                return 0;
+            mask >>= 1;
+            const size_t wordSize = WordSize(f);
+            uint32_t words[MAX_WORDS];
+            for (size_t i = 0; i < Words(f); i++)
+            {
+                words[i] = getWord(rec, i, wordSize);
+                uint64_t z;
+                if (mask & (1ULL << i))
+                {
+                    if (!GetVarint(p, end, z))
+                        return 0;
+                    words[i] = undiff(f.sampleType, words[i], z);
+                }
+            }
+            for (size_t i = 0; i < Words(f); i++)
+                setWord(rec, i, wordSize, words[i]);
+            return p - start;
+        }
+    };
+
+    template <typename RECORD>
     struct FlashSector
     {
         int64_t timeStampSecondsEpoch; // timestamp of the first write to this sector
-        int64_t dummy[7];
-        FourSignals data[(SECTOR_SIZE_BYTES - 8 * sizeof(int64_t)) / sizeof(FourSignals)];
+        int64_t granularity;
+        int64_t recordLayout; // RecordLayout; -1 (geloeschter Flash) = Sektor aus der Zeit vor der Versionierung = MEAN
+        int64_t channels;     // -1 = vor der Versionierung = 4
+        int64_t sampleType;   // SampleType; -1 = vor der Versionierung = INT16
+        int64_t codec;        // SectorCodec; -1 = RAW
+        int64_t eraseCount;   // wie oft dieser Sektor schon geloescht wurde; -1 = unbekannt (fabrikneu oder aus der Zeit vor dem Zaehler) = 0
+        int64_t flags;        // SECTOR_FLAG_*; -1 = Sektor aus der Zeit vor den Pruefsummen = keine
+        // RAW: je Datensatz ein Slot aus RECORD und Pruefsummenbyte, bei SectorCodec::DELTA_VARINT stattdessen ein Bytestrom
+        // variabel langer Datensaetze (ebenfalls je mit Pruefsummenbyte)
+        static constexpr size_t SLOT_SIZE{sizeof(RECORD) + 1};
+        static constexpr size_t CAPACITY{(SECTOR_SIZE_BYTES - SECTOR_HEADER_SIZE_BYTES) / SLOT_SIZE};
+        uint8_t data[CAPACITY * SLOT_SIZE];
+    };
+    static_assert(sizeof(FlashSector<FourSignals>) <= SECTOR_SIZE_BYTES && FlashSector<FourSignals>::CAPACITY == 448);
+    static_assert(offsetof(FlashSector<FourSignals>, eraseCount) == ERASE_COUNT_OFFSET_BYTES);
+    static_assert(offsetof(FlashSector<FourSignals>, flags) == FLAGS_OFFSET_BYTES);
+
+    // Verschleiss des Sektor-Rings einer Granularitaet. Die Raten beziehen sich auf die Zeit seit M::Init.
+    struct GranularityHealth
+    {
+        uint16_t sectorCount;
+        uint32_t minEraseCount;
+        uint32_t maxEraseCount;
+        uint32_t writesPerDay; // esp_partition_write-Aufrufe
+        uint32_t erasesPerDay; // tatsaechlich gemessen
+        float yearsLeft;       // bis der am meisten geloeschte Sektor FLASH_ERASE_ENDURANCE erreicht; -1 = noch nicht abschaetzbar
+    };
+
+    struct FlashHealth
+    {
+        uint32_t secondsObserved;
+        uint32_t writesPerDay;
+        uint32_t erasesPerDay;
+        float yearsLeft; // Minimum ueber alle Granularitaeten -- der erste verschlissene Sektor macht die Partition unbrauchbar
+        std::array<GranularityHealth, (size_t)Granularity::MAX> granularities;
     };
 
-    constexpr std::array<GranularityConfig, (size_t)Granularity::MAX> GRANULARITY_CONFIG = {{{SECTORS_10sec_START, SECTORS_10sec, SECTOR_HEADER_SIZE_BYTES, ReadingFusionStrategy::NONE, 0},
-                                                                                             {SECTORS_1min_START, SECTORS_1min, SECTOR_HEADER_SIZE_BYTES, ReadingFusionStrategy::AFTER_CERTAIN_READINGS_OF_PREVIOUS, 6},
-                                                                                             {SECTORS_1hour_START, SECTORS_1hour, SECTOR_HEADER_SIZE_BYTES, ReadingFusionStrategy::AFTER_CERTAIN_READINGS_OF_PREVIOUS, 60},
-                                                                                             {SECTORS_1day_START, SECTORS_1day, SECTOR_HEADER_SIZE_BYTES, ReadingFusionStrategy::AFTER_CERTAIN_READINGS_OF_PREVIOUS, 24}}};
+    // STAGING_SAMPLES: 10s -> 30 Samples = max. 5min Verlust bei Stromausfall (statt 30 einzelner 8-Byte-Writes ein 240-Byte-Write),
+    // 1min -> 5 Samples = ebenfalls max. 5min; Stunden- und Tageswerte sind selten und zu wertvoll, die gehen sofort ins Flash.
+    constexpr std::array<GranularityConfig, (size_t)Granularity::MAX> GRANULARITY_CONFIG = {{{SECTORS_10sec_START, SECTORS_10sec, SECTOR_HEADER_SIZE_BYTES, ReadingFusionStrategy::NONE, 0, 30, 10},
+                                                                                             {SECTORS_1min_START, SECTORS_1min, SECTOR_HEADER_SIZE_BYTES, ReadingFusionStrategy::AFTER_CERTAIN_READINGS_OF_PREVIOUS, 6, 5, 60},
+                                                                                             {SECTORS_1hour_START, SECTORS_1hour, SECTOR_HEADER_SIZE_BYTES, ReadingFusionStrategy::AFTER_CERTAIN_READINGS_OF_PREVIOUS, 60, 1, 3600},
+                                                                                             {SECTORS_1day_START, SECTORS_1day, SECTOR_HEADER_SIZE_BYTES, ReadingFusionStrategy::AFTER_CERTAIN_READINGS_OF_PREVIOUS, 24, 1, 86400}}};
+    // bei groesseren Datensaetzen (mehr Kanaele, MEAN_MIN_MAX_LAST) wird bei vollem Puffer entsprechend frueher geschrieben
+    static_assert(GRANULARITY_CONFIG[0].STAGING_SAMPLES * FlashSector<FourSignals>::SLOT_SIZE <= MAX_STAGING_BYTES);
+    // Zeitabstand der Rohdatensaetze; die Abtastperiode muss ihn ganzzahlig teilen (mehrere Samples -> ein Datensatz)
+    constexpr uint32_t RAW_RECORD_PERIOD_MS{GRANULARITY_CONFIG[0].SECONDS_PER_RECORD * 1000};
+
+    // Abtastung (s. M::Init). Jitter = Abweichung des Abstands zweier esp_timer-Callbacks von der Abtastperiode.
+    struct SamplingStats
+    {
+        uint32_t periodMs;
+        uint32_t samples;
+        uint32_t dropped; // Warteschlange voll, der Worker kam nicht hinterher
+        uint32_t jitterMaxUs;
+        uint32_t jitterMeanUs;
+        uint32_t workerLatencyMaxUs; // von der Abtastung bis zur Verarbeitung im Worker
+    };
+
+    // Lock-freie Warteschlange fuer genau einen Schreiber und genau einen Leser. 'tail' wird nur vom Schreiber, 'head'
+    // nur vom Leser veraendert; ein Platz bleibt frei, um voll und leer zu unterscheiden.
+    template <typename ITEM, size_t LEN>
+    class SpscQueue
+    {
+    private:
+        std::array<ITEM, LEN> items{};
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+
+    public:
+        bool Push(const ITEM &item)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t next = (t + 1) % LEN;
+            if (next == head.load(std::memory_order_acquire))
+                return false;
+            items[t] = item;
+            tail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        bool Pop(ITEM &item)
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+                return false;
+            item = items[h];
+            head.store((h + 1) % LEN, std::memory_order_release);
+            return true;
+        }
+    };
 
+    // Verwaltung des Sektor-Rings einer Granularitaet. Arbeitet bewusst nur mit Bytes und der (zur Compilezeit
+    // in M bestimmten) Datensatzgroesse aus RecordFormat -- so gibt es den Code nur einmal, egal mit welchen
+    // Template-Parametern M instanziiert ist.
     class GranularityRuntime
     {
     public:
@@ -85,150 +526,594 @@ namespace timeseries
         size_t offsetBytes; // write location; absolute byte offset in sector (not how many packets have been written ), 64byte header is included
         const GranularityConfig *cfg;
         size_t writeCounter;
+        RecordFormat format;
+        // Noch nicht ins Flash geschriebene Datensaetze. Sie gehoeren immer zum aktuellen Sektor 'sectorIndex' und liegen
+        // dort ab 'stagedOffsetBytes' lueckenlos -- offsetBytes zaehlt sie bereits mit (logische Schreibposition).
+        std::array<uint8_t, MAX_STAGING_BYTES> staging;
+        size_t stagedCount{0};
+        size_t stagedBytes{0};
+        size_t stagedOffsetBytes{0};
+        // DELTA_VARINT: zuletzt geschriebener Datensatz (unkodiert) als Bezug fuer den naechsten
+        std::array<uint8_t, MAX_STAGING_BYTES> previous{};
+        size_t sectorRecords{0};
+        // Lesen ausschliesslich ueber die per esp_partition_mmap eingeblendete Partition (s. M::Init). esp_partition_write
+        // und esp_partition_erase_range invalidieren den Cache fuer den betroffenen Bereich, die Sicht ist also aktuell.
+        const uint8_t *mapped{nullptr};
+        // Zaehler seit M::Init fuer die Verschleissprognose
+        uint32_t writes{0};
+        uint32_t erases{0};
+        uint64_t appendedBytes{0};
+        // Recovery (s. Init): Zeitpunkt des letzten Datensatzes im Flash, -1 = keiner
+        int64_t lastRecordEpoch{-1};
 
-        GranularityRuntime(Granularity granularity) : granularity(granularity),
-                                                      sectorIndex(GRANULARITY_CONFIG[(size_t)granularity].SECTOR_START),
-                                                      offsetBytes(0),
-                                                      cfg(&GRANULARITY_CONFIG[(size_t)granularity]),
-                                                      writeCounter(0)
+        GranularityRuntime(Granularity granularity, RecordFormat format) : granularity(granularity),
+                                                                           sectorIndex(GRANULARITY_CONFIG[(size_t)granularity].SECTOR_START),
+                                                                           offsetBytes(0),
+                                                                           cfg(&GRANULARITY_CONFIG[(size_t)granularity]),
+                                                                           writeCounter(0),
+                                                                           format(format)
         {
         }
 
-        void Init(const esp_partition_t *partition)
+        // Stellt nach einem Neustart die Schreibposition wieder her, mit wenigen Zugriffen auf den eingeblendeten Flash:
+        //  - der neueste Sektor per Binaersuche ueber die Sektorkoepfe (ab SECTOR_START aufsteigend beschrieben, alle
+        //    danach sind aelter oder leer),
+        //  - darin das Datenende per Binaersuche nach dem ersten Slot mit 0xFF als Pruefsumme (RAW) bzw. durch Dekodieren
+        //    (DELTA_VARINT, geht nur der Reihe nach).
+        // Ist der Sektor nicht voll und steht hinter dem Datenende wirklich nur geloeschter Flash, wird er fortgesetzt (s.
+        // bridgeGap), sonst geht es mit dem naechsten -- und damit aeltesten -- weiter. Geloescht wird hier nie, das macht
+        // erst PrepareNewSector beim ersten Schreiben; ein falsch erkannter Sektor kostet also keine Daten.
+        void Init(const esp_partition_t *partition, const uint8_t *mapped)
         {
-            int64_t lastTimeEpochSeconds{0};
-            // wir suchen den sector, bei dem die Zeit erstmal im Vergleich zum vorherigen nach unten geht
-            bool found{false};
-            for (size_t secIndex = cfg->SECTOR_START; secIndex < cfg->SECTOR_START + cfg->SECTOR_CNT; secIndex++)
+            this->mapped = mapped;
+            const size_t start = cfg->SECTOR_START;
+            size_t newest{start};
+            int64_t firstTime = SectorHeader(start)[0];
+            if (firstTime != -1)
             {
-                int64_t newTime{-1};
-                ESP_ERROR_CHECK(esp_partition_read(partition, SECTOR_SIZE_BYTES * secIndex, &newTime, 8));
-                if (newTime < lastTimeEpochSeconds)
+                size_t lo{1};
+                size_t hi{cfg->SECTOR_CNT};
+                while (lo < hi)
                 {
-                    if (newTime != -1)
-                    {
-                        // wenn die Zeit nicht auf "-1" zurück geht (=binär zweierkomplement 0xFFFF..), dann muss formatiert werden
-                        ESP_LOGI(TAG, "Found initial sector %d for granularity %d. As the sector is NOT empty, I am going to erase it", secIndex, (int)granularity);
-                        ESP_ERROR_CHECK(esp_partition_erase_range(partition, SECTOR_SIZE_BYTES * secIndex, SECTOR_SIZE_BYTES));
-                    }
+                    size_t mid = (lo + hi) / 2;
+                    if (SectorHeader(start + mid)[0] < firstTime)
+                        hi = mid;
                     else
+                        lo = mid + 1;
+                }
+                newest = start + lo - 1;
+            }
+            else
+            {
+                // erster Sektor leer: entweder der ganze Ring, oder der Neustart kam zwischen Loeschen und Schreiben des Kopfes
+                int64_t newestTime{-1};
+                for (size_t s = start + 1; s < start + cfg->SECTOR_CNT; s++)
+                {
+                    if (SectorHeader(s)[0] > newestTime)
                     {
-                        ESP_LOGI(TAG, "Found initial sector %d for granularity %d. As the sector is empty, I do not need to erase it.", secIndex, (int)granularity);
+                        newestTime = SectorHeader(s)[0];
+                        newest = s;
                     }
-                    found = true;
-                    sectorIndex = secIndex;
-                    break;
                 }
-                lastTimeEpochSeconds = newTime;
+                if (newestTime == -1)
+                {
+                    ESP_LOGI(TAG, "Granularity %d: ring is empty, starting at sector %d", (int)granularity, (int)start);
+                    sectorIndex = start;
+                    offsetBytes = 0;
+                    return;
+                }
             }
-            if (!found)
+
+            sectorIndex = newest;
+            offsetBytes = 0;
+            const int64_t *hdr = SectorHeader(newest);
+            if (!IsOwnFormat(hdr) || !HasChecksum(hdr))
             {
-                // wenn die Zeit niemals kleiner wird und auch nirgends ein leerer Sektor ist, dann ist der erste betrachtete Sektor der älteste
-                ESP_LOGI(TAG, "Must use initial sector %d for granularity %d. As the sector is NOT empty, I am going to erase it", cfg->SECTOR_START, (int)granularity);
-                ESP_ERROR_CHECK(esp_partition_erase_range(partition, SECTOR_SIZE_BYTES * cfg->SECTOR_START, SECTOR_SIZE_BYTES));
-                sectorIndex = 0;
+                ESP_LOGI(TAG, "Granularity %d: newest sector %d has a different format, continuing with the next one", (int)granularity, (int)newest);
+                nextSector();
+                return;
             }
-            //TODO: Start 10seconds-Timer
+            size_t records{0};
+            size_t end = findDataEnd(newest, records);
+            if (records > 0)
+                lastRecordEpoch = hdr[0] + (int64_t)(records - 1) * cfg->SECONDS_PER_RECORD;
+            const size_t maxSize = MaxEncodedSize();
+            if (end + maxSize > SECTOR_SIZE_BYTES || !IsErased(mapped + SECTOR_SIZE_BYTES * newest + end, maxSize))
+            {
+                ESP_LOGI(TAG, "Granularity %d: newest sector %d holds %d records and cannot be continued", (int)granularity, (int)newest, (int)records);
+                nextSector();
+                return;
+            }
+            offsetBytes = end;
+            sectorRecords = records;
+            ESP_LOGI(TAG, "Granularity %d: continuing sector %d after %d records", (int)granularity, (int)newest, (int)records);
+        }
+
+        // writeCounter = Datensaetze seit dem letzten der naechstgroeberen Granularitaet; nach einem Neustart aus den
+        // Zeitpunkten der jeweils letzten Datensaetze geschaetzt (die halb fertigen Aggregate im RAM sind ohnehin verloren)
+        void RestoreWriteCounter(const GranularityRuntime &coarser)
+        {
+            writeCounter = 0;
+            if (lastRecordEpoch < 0)
+                return;
+            int64_t n = coarser.lastRecordEpoch < 0 ? (int64_t)sectorRecords : (lastRecordEpoch - coarser.lastRecordEpoch) / (int64_t)cfg->SECONDS_PER_RECORD;
+            writeCounter = (size_t)std::clamp<int64_t>(n, 0, (int64_t)coarser.cfg->HOW_MANY_READING_DO_I_NEED_FROM_PREVIOUS - 1);
+        }
+
+        void nextSector()
+        {
+            sectorIndex++;
+            if (sectorIndex == cfg->SECTOR_START + cfg->SECTOR_CNT)
+            {
+                sectorIndex = cfg->SECTOR_START;
+            }
+            offsetBytes = 0;
+        }
+
+        static bool HasChecksum(const int64_t *hdr)
+        {
+            return hdr[7] != -1 && (hdr[7] & SECTOR_FLAG_RECORD_CHECKSUM);
+        }
+
+        // 8-Bit-Pruefsumme eines Datensatzes. Nie 0xFF: ein Slot mit 0xFF an dieser Stelle ist (noch) geloescht -- daran
+        // erkennt Init das Datenende per Binaersuche, ohne die Datenbytes selbst anzusehen.
+        static uint8_t RecordChecksum(const uint8_t *p, size_t len)
+        {
+            uint8_t c{0x5A};
+            for (size_t i = 0; i < len; i++)
+                c = (uint8_t)(((c << 1) | (c >> 7)) + p[i]);
+            return c == 0xFF ? 0xFE : c;
+        }
+
+        // Datenende (Offset im Sektor) und Anzahl der Slots im eigenen, geprueften Format; bei DELTA_VARINT danach in
+        // 'previous' der letzte gueltige Datensatz als Bezug fuer den naechsten
+        size_t findDataEnd(size_t physical, size_t &records)
+        {
+            const uint8_t *sector = mapped + SECTOR_SIZE_BYTES * physical;
+            if (format.codec == SectorCodec::RAW)
+            {
+                const size_t slotSize = format.recordSize + 1;
+                size_t lo{0};
+                size_t hi{(SECTOR_SIZE_BYTES - SECTOR_HEADER_SIZE_BYTES) / slotSize};
+                while (lo < hi)
+                {
+                    size_t mid = (lo + hi) / 2;
+                    if (sector[SECTOR_HEADER_SIZE_BYTES + mid * slotSize + format.recordSize] == 0xFF)
+                        hi = mid;
+                    else
+                        lo = mid + 1;
+                }
+                records = lo;
+                return SECTOR_HEADER_SIZE_BYTES + lo * slotSize;
+            }
+            previous.fill(0);
+            size_t offset{SECTOR_HEADER_SIZE_BYTES};
+            records = 0;
+            bool valid;
+            while (size_t len = decodeDeltaSlot(true, previous.data(), sector + offset, sector + SECTOR_SIZE_BYTES, valid))
+            {
+                offset += len;
+                records++;
+            }
+            return offset;
+        }
+
+        // DELTA_VARINT: dekodiert den Slot ab 'p' (hoechstens bis 'end') in 'record' (= bisher der Vorgaenger). Rueckgabe:
+        // Slotlaenge, 0 = Datenende. 'valid' = Pruefsumme stimmt; nur dann wird 'record' ueberschrieben.
+        size_t decodeDeltaSlot(bool checksummed, uint8_t *record, const uint8_t *p, const uint8_t *end, bool &valid) const
+        {
+            uint8_t decoded[MAX_STAGING_BYTES];
+            memcpy(decoded, record, format.recordSize);
+            size_t len = DeltaVarintCodec::Decode(format, decoded, p, end);
+            if (len == 0)
+                return 0;
+            valid = true;
+            if (checksummed)
+            {
+                if (p + len >= end)
+                    return 0;
+                valid = p[len] == RecordChecksum(p, len);
+                len++;
+            }
+            if (valid)
+                memcpy(record, decoded, format.recordSize);
+            return len;
+        }
+
+        uint32_t EraseCount(size_t physical) const
+        {
+            int64_t c = SectorHeader(physical)[ERASE_COUNT_OFFSET_BYTES / sizeof(int64_t)];
+            return c < 0 ? 0 : (uint32_t)c;
+        }
+
+        // Loescht einen Sektor und schreibt den um eins erhoehten Loeschzaehler sofort wieder in den Kopf -- so bleibt er auch
+        // erhalten, wenn der Sektor erst spaeter (PrepareNewSector) oder vor dem naechsten Neustart gar nicht mehr beschrieben wird
+        void EraseSector(const esp_partition_t *partition, size_t physical)
+        {
+            int64_t eraseCount = (int64_t)EraseCount(physical) + 1;
+            ESP_ERROR_CHECK(esp_partition_erase_range(partition, SECTOR_SIZE_BYTES * physical, SECTOR_SIZE_BYTES));
+            ESP_ERROR_CHECK(esp_partition_write(partition, SECTOR_SIZE_BYTES * physical + ERASE_COUNT_OFFSET_BYTES, &eraseCount, sizeof(eraseCount)));
+            erases++;
+            writes++;
         }
 
         void PrepareNewSector(const esp_partition_t *partition, time_t secondsEpoch)
         {
             // checks, whether the sector needs to be formatted
-            int64_t buf[8];
-            ESP_ERROR_CHECK(esp_partition_read(partition, SECTOR_SIZE_BYTES * sectorIndex, buf, 8));
-            if (buf[0] != -1)
+            if (SectorHeader(sectorIndex)[0] != -1)
             {
-                ESP_ERROR_CHECK(esp_partition_erase_range(partition, SECTOR_SIZE_BYTES * sectorIndex, SECTOR_SIZE_BYTES));
+                EraseSector(partition, sectorIndex);
             }
+            // eraseCount hat EraseSector bereits geschrieben; hier nur die Felder davor und dahinter
+            int64_t buf[ERASE_COUNT_OFFSET_BYTES / sizeof(int64_t)];
             buf[0]=secondsEpoch;
             buf[1]=(int64_t)this->granularity;
-            ESP_ERROR_CHECK(esp_partition_write(partition, SECTOR_SIZE_BYTES * sectorIndex, buf, 16));
+            buf[2]=(int64_t)this->format.layout;
+            buf[3]=(int64_t)this->format.channels;
+            buf[4]=(int64_t)this->format.sampleType;
+            buf[5]=(int64_t)this->format.codec;
+            int64_t flags{SECTOR_FLAG_RECORD_CHECKSUM};
+            ESP_ERROR_CHECK(esp_partition_write(partition, SECTOR_SIZE_BYTES * sectorIndex, buf, sizeof(buf)));
+            ESP_ERROR_CHECK(esp_partition_write(partition, SECTOR_SIZE_BYTES * sectorIndex + FLAGS_OFFSET_BYTES, &flags, sizeof(flags)));
+            writes += 2;
+            previous.fill(0);
+            sectorRecords = 0;
         }
 
-        void AverageNReadingsAndResetWriteCounter(const esp_partition_t *partition, size_t n, FourSignals *signals)
+        GranularityHealth GetHealth(uint32_t secondsObserved) const
         {
-            // wir können beim Aufruf sicher sein, dass die Anzahl auch wirklich vorhanden ist. Aber wird müssen ggf über Buffergrezen hinweg
-            size_t currentSectorIndex = this->sectorIndex;
-            size_t currentOffsetBytes = this->offsetBytes;
-            int32_t averageBuffer[4] = {0};
-            int16_t readBuffer[4];
-            for (size_t i = 0; i < n; i++)
+            GranularityHealth h{};
+            h.sectorCount = cfg->SECTOR_CNT;
+            h.minEraseCount = UINT32_MAX;
+            for (size_t s = cfg->SECTOR_START; s < cfg->SECTOR_START + cfg->SECTOR_CNT; s++)
             {
-                currentOffsetBytes -= 8;
-                if (currentOffsetBytes < 64)
-                {
-                    currentSectorIndex--;
-                    currentOffsetBytes = SECTOR_SIZE_BYTES - 8;
-                    if (currentSectorIndex < cfg->SECTOR_START)
-                    {
-                        currentOffsetBytes = cfg->SECTOR_START + cfg->SECTOR_CNT;
-                    }
-                }
-                ESP_ERROR_CHECK(esp_partition_read(partition, SECTOR_SIZE_BYTES * currentSectorIndex + currentOffsetBytes, readBuffer, 8));
-                for (int j = 0; j < 4; j++)
-                    averageBuffer[j] += readBuffer[j];
+                h.minEraseCount = std::min(h.minEraseCount, EraseCount(s));
+                h.maxEraseCount = std::max(h.maxEraseCount, EraseCount(s));
+            }
+            h.yearsLeft = -1;
+            if (secondsObserved == 0)
+                return h;
+            h.writesPerDay = (uint32_t)((uint64_t)writes * 86400 / secondsObserved);
+            h.erasesPerDay = (uint32_t)((uint64_t)erases * 86400 / secondsObserved);
+            // Die Prognose haengt an der geschriebenen Datenmenge, nicht an den gemessenen Loeschungen -- die ersten gibt
+            // es beim 10s-Ring erst nach Stunden, bei den Tageswerten nach Jahren. Der Ring verteilt die Loeschungen
+            // gleichmaessig, jeder Sektor wird also einmal je SECTOR_CNT gefuellte Sektoren geloescht.
+            double sectorsPerDay = (double)appendedBytes * 86400 / secondsObserved / (SECTOR_SIZE_BYTES - SECTOR_HEADER_SIZE_BYTES);
+            if (sectorsPerDay > 0)
+            {
+                double erasesPerSectorAndYear = sectorsPerDay / cfg->SECTOR_CNT * 365;
+                h.yearsLeft = h.maxEraseCount >= FLASH_ERASE_ENDURANCE ? 0 : (float)((FLASH_ERASE_ENDURANCE - h.maxEraseCount) / erasesPerSectorAndYear);
             }
-            for (int j = 0; j < 4; j++)
-                signals->values[j] = averageBuffer[j] / n;
-            this->writeCounter = 0;
+            return h;
         }
 
-        void Write(const esp_partition_t *partition, time_t secondsEpoch, FourSignals *signals)
+        // Obergrenze fuer den Platzbedarf eines Datensatzes in diesem Format, inklusive Pruefsummenbyte
+        size_t MaxEncodedSize() const
         {
+            return (format.codec == SectorCodec::RAW ? format.recordSize : DeltaVarintCodec::MaxEncodedSize(format)) + 1;
+        }
+
+        // Schreibt die im RAM gesammelten Samples mit einem einzigen esp_partition_write
+        void Flush(const esp_partition_t *partition)
+        {
+            if (stagedCount == 0)
+                return;
+            ESP_ERROR_CHECK(esp_partition_write(partition, SECTOR_SIZE_BYTES * sectorIndex + stagedOffsetBytes, staging.data(), stagedBytes));
+            writes++;
+            stagedCount = 0;
+            stagedBytes = 0;
+        }
+
+        // 'record' zeigt auf einen Record mit format.recordSize Bytes
+        void Write(const esp_partition_t *partition, time_t secondsEpoch, const void *record)
+        {
+            if (offsetBytes > 0)
+                bridgeGap(partition, secondsEpoch);
             if (offsetBytes == 0)
             {
                 PrepareNewSector(partition, secondsEpoch);
-                offsetBytes = 64;
+                offsetBytes = SECTOR_HEADER_SIZE_BYTES;
             }
-            ESP_ERROR_CHECK(esp_partition_write(partition, SECTOR_SIZE_BYTES * sectorIndex + offsetBytes, signals->values, sizeof(FourSignals)));
-            offsetBytes += sizeof(FourSignals);
+            appendSlot(partition, record);
             writeCounter++;
-            if (offsetBytes >= SECTOR_SIZE_BYTES)
+        }
+
+        // Im Sektor ergeben sich die Zeitpunkte aus Kopf-Zeitstempel + Index. Liegt 'secondsEpoch' mindestens einen
+        // Datensatzabstand hinter dem naechsten Slot (Zeit ohne Strom nach einem Neustart, ausgefallene Samples, vorgestellte
+        // Uhr), wird die Luecke mit Fuellslots (ungueltige Pruefsumme, Leser ueberspringen sie) ueberbrueckt. Passt sie nicht
+        // mehr in den Sektor oder liegt die Zeit vor dem naechsten Slot (Uhr zurueckgestellt bzw. vor dem Neustart noch
+        // nicht per SNTP gestellt), geht es mit einem neuen Sektor weiter.
+        void bridgeGap(const esp_partition_t *partition, time_t secondsEpoch)
+        {
+            const int64_t interval = cfg->SECONDS_PER_RECORD;
+            int64_t drift = secondsEpoch - (SectorHeader(sectorIndex)[0] + (int64_t)sectorRecords * interval);
+            if (drift > -interval && drift < interval)
+                return;
+            int64_t missing = drift / interval;
+            size_t freeSlots = (SECTOR_SIZE_BYTES - offsetBytes) / MaxEncodedSize();
+            if (drift < 0 || missing >= (int64_t)freeSlots)
             {
-                sectorIndex++;
-                if (sectorIndex == cfg->SECTOR_START + cfg->SECTOR_CNT)
+                ESP_LOGI(TAG, "Granularity %d: time is %llds off the next slot of sector %d, continuing with a new sector", (int)granularity, (long long)drift, (int)sectorIndex);
+                Flush(partition); // was noch im RAM liegt, gehoert zum bisherigen Sektor
+                nextSector();
+                return;
+            }
+            for (int64_t i = 0; i < missing; i++)
+                appendSlot(partition, nullptr);
+        }
+
+        // haengt einen Slot (Datensatz + Pruefsumme) an; record==nullptr: Fuellslot mit ungueltiger Pruefsumme
+        void appendSlot(const esp_partition_t *partition, const void *record)
+        {
+            const size_t maxSize = MaxEncodedSize();
+            if (stagedBytes + maxSize > staging.size())
+                Flush(partition);
+            if (stagedCount == 0)
+                stagedOffsetBytes = offsetBytes;
+            uint8_t *slot = staging.data() + stagedBytes;
+            size_t len = format.recordSize;
+            if (format.codec == SectorCodec::DELTA_VARINT)
+            {
+                if (record)
                 {
-                    sectorIndex = cfg->SECTOR_START;
+                    len = DeltaVarintCodec::Encode(format, previous.data(), (const uint8_t *)record, slot);
+                    memcpy(previous.data(), record, format.recordSize);
                 }
-                offsetBytes = 0;
+                else
+                {
+                    slot[0] = 0; // leere Maske = unveraendert
+                    len = 1;
+                }
+            }
+            else if (record)
+            {
+                memcpy(slot, record, len);
+            }
+            else
+            {
+                memset(slot, 0, len);
+            }
+            uint8_t checksum = RecordChecksum(slot, len);
+            slot[len++] = record ? checksum : (checksum == 0 ? 1 : 0);
+            stagedCount++;
+            stagedBytes += len;
+            offsetBytes += len;
+            appendedBytes += len;
+            sectorRecords++;
+            bool sectorFull = offsetBytes + maxSize > SECTOR_SIZE_BYTES;
+            if (stagedCount >= cfg->STAGING_SAMPLES || sectorFull)
+            {
+                Flush(partition);
+            }
+            if (sectorFull)
+            {
+                ESP_LOGD(TAG, "Sector %d of granularity %d full with %d records", (int)sectorIndex, (int)granularity, (int)sectorRecords);
+                nextSector();
             }
         }
 
-        void ReadFullSector4096bytes(const esp_partition_t *partition, int goBack, void *buf)
+        // Sektor Nummer 'k' in zeitlicher Reihenfolge (0=aeltester, SECTOR_CNT-1=neuester). Solange im aktuellen Sektor
+        // noch nichts steht (offsetBytes==0), enthaelt er noch die Daten der aeltesten Runde (oder ist leer) und ist damit
+        // selbst der aelteste.
+        size_t PhysicalSector(size_t k) const
         {
-            size_t s = (((sectorIndex - cfg->SECTOR_START) - goBack) % cfg->SECTOR_CNT) + cfg->SECTOR_START; // checked with online gdb
-            ESP_ERROR_CHECK(esp_partition_read(partition, SECTOR_SIZE_BYTES * s, buf, SECTOR_SIZE_BYTES));
+            size_t newest = sectorIndex - cfg->SECTOR_START + (offsetBytes > 0 ? 0 : cfg->SECTOR_CNT - 1);
+            return cfg->SECTOR_START + (newest + 1 + k) % cfg->SECTOR_CNT;
+        }
+
+        // Kopf eines Sektors (s. FlashSector) direkt im eingeblendeten Flash
+        const int64_t *SectorHeader(size_t physical) const
+        {
+            return reinterpret_cast<const int64_t *>(mapped + SECTOR_SIZE_BYTES * physical);
+        }
+
+        // true, wenn der Sektor Datensaetze im eigenen Format enthaelt; -1 (Sektoren aus der Zeit vor der Versionierung) = MEAN, 4 Kanaele, INT16, RAW
+        bool IsOwnFormat(const int64_t *hdr) const
+        {
+            RecordLayout layout = hdr[2] == -1 ? RecordLayout::MEAN : (RecordLayout)hdr[2];
+            int64_t channels = hdr[3] == -1 ? 4 : hdr[3];
+            SampleType sampleType = hdr[4] == -1 ? SampleType::INT16 : (SampleType)hdr[4];
+            SectorCodec codec = hdr[5] == -1 ? SectorCodec::RAW : (SectorCodec)hdr[5];
+            return layout == format.layout && channels == format.channels && sampleType == format.sampleType && codec == format.codec;
+        }
+
+        static bool IsErased(const uint8_t *p, size_t len)
+        {
+            for (size_t i = 0; i < len; i++)
+                if (p[i] != 0xFF)
+                    return false;
+            return true;
+        }
+
+        // Ruft fn(index, record) der Reihe nach fuer die Datensaetze first <= index < end eines Sektors im eigenen Format
+        // auf, bis zum Datenende (geloeschter Flash) oder bis fn false liefert (Rueckgabe dann false). Slots mit falscher
+        // Pruefsumme (Fuellslots, beim Stromausfall halb geschriebene) werden uebersprungen, belegen aber ihren Index.
+        // 'record' zeigt bei RAW direkt in den eingeblendeten Flash bzw. in 'staging' -- kein Lesepuffer, keine Kopie.
+        // DELTA_VARINT dekodiert vom Sektoranfang an in einen einzelnen Datensatz auf dem Stack.
+        template <typename F>
+        bool ForEachRecord(size_t physical, size_t first, size_t end, F &&fn) const
+        {
+            const uint8_t *sector = mapped + SECTOR_SIZE_BYTES * physical;
+            const bool checksummed = HasChecksum(SectorHeader(physical));
+            const bool current = physical == sectorIndex && offsetBytes > 0;
+            const size_t limit = current ? offsetBytes : SECTOR_SIZE_BYTES;
+            // ab 'flashEnd' stehen die Daten noch nicht im Flash, sondern in 'staging'; Flush schreibt immer ganze
+            // Slots, ein Slot liegt also nie teils hier, teils dort
+            const size_t flashEnd = (current && stagedCount > 0) ? stagedOffsetBytes : limit;
+            auto at = [&](size_t offset)
+            { return offset < flashEnd ? sector + offset : staging.data() + (offset - flashEnd); };
+            const size_t recordSize = format.recordSize;
+            if (format.codec == SectorCodec::RAW)
+            {
+                const size_t slotSize = recordSize + (checksummed ? 1 : 0);
+                end = std::min(end, (limit - SECTOR_HEADER_SIZE_BYTES) / slotSize);
+                for (size_t i = first; i < end; i++)
+                {
+                    const uint8_t *record = at(SECTOR_HEADER_SIZE_BYTES + i * slotSize);
+                    if (checksummed ? record[recordSize] == 0xFF : IsErased(record, recordSize))
+                        return true;
+                    if (checksummed && record[recordSize] != RecordChecksum(record, recordSize))
+                        continue;
+                    if (!fn(i, record))
+                        return false;
+                }
+                return true;
+            }
+
+            uint8_t record[MAX_STAGING_BYTES]{};
+            size_t offset{SECTOR_HEADER_SIZE_BYTES};
+            for (size_t i = 0; i < end && offset < limit; i++)
+            {
+                size_t segmentEnd = offset < flashEnd ? flashEnd : limit;
+                bool valid;
+                size_t len = decodeDeltaSlot(checksummed, record, at(offset), at(offset) + (segmentEnd - offset), valid);
+                if (len == 0)
+                    return true;
+                offset += len;
+                if (valid && i >= first && !fn(i, record))
+                    return false;
+            }
+            return true;
         }
     };
 
-    class M;
-    class M
+    // Liefert einen Datensatz von Query; 'values' hat 'channels' Eintraege, gefuellt sind nur die in 'channelMask'
+    // gesetzten. Rueckgabe false bricht die Abfrage ab (z.B. weil der Antwortpuffer voll ist).
+    typedef bool (*QueryRowFn)(void *ctx, time_t secondsEpoch, uint32_t channelMask, const QueryValue *values, size_t channels);
+
+    // Lesezugriff auf einen Speicher unabhaengig von dessen Template-Parametern (fuer das Websocket-Plugin)
+    class iTimeseries
+    {
+    public:
+        // Alle Datensaetze der Granularitaet g mit fromEpoch <= Zeitpunkt <= toEpoch, zeitlich aufsteigend. Der passende
+        // Sektor wird per Binaersuche ueber die Zeitstempel der Sektorkoepfe gefunden, gelesen werden nur die benoetigten
+        // Datensaetze. 'fn' wird unter dem Lock des Speichers aufgerufen, darf also nicht blockieren.
+        virtual ErrorCode Query(Granularity g, time_t fromEpoch, time_t toEpoch, uint32_t channelMask, QueryRowFn fn, void *ctx) = 0;
+        virtual RecordFormat GetRecordFormat(Granularity g) = 0;
+        virtual ErrorCode GetFlashHealth(FlashHealth &health) = 0;
+        virtual SamplingStats GetSamplingStats() = 0;
+    };
+
+    // T/N: Sampletyp und Kanalanzahl (z.B. 16 Kanaele float auf groesseren Boards, Standard wie bisher 4x int16)
+    // ROLLUP_LAYOUT: Datensatzformat der Granularitaeten ONE_MINUTE..ONE_DAY (s. RecordLayout)
+    // CODEC: Kodierung der Sektoren aller Granularitaeten (s. SectorCodec); DELTA_VARINT lohnt fuer langsame Signale
+    template <typename T = int16_t, size_t N = 4, RecordLayout ROLLUP_LAYOUT = RecordLayout::MEAN, SectorCodec CODEC = SectorCodec::RAW>
+    class M : public iTimeseries
     {
     private:
+        using Sample = Signals<T, N>;
+        using RawRecord = Record<RecordLayout::MEAN, T, N>;
+        using RollupRecord = Record<ROLLUP_LAYOUT, T, N>;
+        static_assert(N > 0 && N <= 16, "1..16 channels");
+        static_assert(sizeof(RollupRecord) <= MAX_STAGING_BYTES, "a single record must fit into the staging buffer");
+        static_assert(FlashSector<RawRecord>::CAPACITY > 0 && FlashSector<RollupRecord>::CAPACITY > 0);
+        static constexpr RecordFormat RAW_FORMAT{RecordLayout::MEAN, sizeof(RawRecord), (uint8_t)N, SampleTraits<T>::TYPE, CODEC};
+        static constexpr RecordFormat ROLLUP_FORMAT{ROLLUP_LAYOUT, sizeof(RollupRecord), (uint8_t)N, SampleTraits<T>::TYPE, CODEC};
+        static_assert(CODEC == SectorCodec::RAW || (DeltaVarintCodec::Words(ROLLUP_FORMAT) <= DeltaVarintCodec::MAX_WORDS && DeltaVarintCodec::MaxEncodedSize(ROLLUP_FORMAT) <= MAX_STAGING_BYTES),
+                      "record too large for DELTA_VARINT");
+
+        // ein Abtastwert auf dem Weg vom esp_timer-Callback zum Worker
+        struct QueuedSample
+        {
+            Sample sample;
+            time_t secondsEpoch;
+            int64_t sampledUs;
+        };
+
         static M *singleton;
+        // die per Init gestartete Instanz (auch wenn die Anwendung M selbst angelegt hat) -- fuer den Shutdown-Handler
+        static M *initialized;
         SemaphoreHandle_t semaphore{nullptr};
-        TimerHandle_t tmr{nullptr};
+        esp_timer_handle_t sampleTimer{nullptr};
+        TaskHandle_t worker{nullptr};
+        // Schreiber: esp_timer-Task; Leser: wer 'semaphore' haelt (Worker oder Flush) -- damit immer nur einer
+        SpscQueue<QueuedSample, SAMPLE_QUEUE_LENGTH> queue;
+        uint32_t samplePeriodMs{RAW_RECORD_PERIOD_MS};
+        uint32_t samplesPerRecord{1};
+        // nur im esp_timer-Task geschrieben (workerLatencyMaxUs nur vom Leser der Warteschlange); ein Leser in einem
+        // anderen Task sieht schlimmstenfalls einen halb aktualisierten Stand, das ist fuer die Diagnose unerheblich
+        SamplingStats samplingStats{};
+        int64_t lastSampleUs{0};
+        uint64_t jitterSumUs{0};
+        uint32_t jitterCount{0};
         const esp_partition_t *partition{nullptr};
+        esp_partition_mmap_handle_t mmapHandle{};
+        int64_t initUs{0};
         std::array<GranularityRuntime, (size_t)Granularity::MAX> granularityRuntime = {{
-            GranularityRuntime(Granularity::TEN_SECONDS),
-            GranularityRuntime(Granularity::ONE_MINUTE),
-            GranularityRuntime(Granularity::ONE_HOUR),
-            GranularityRuntime(Granularity::ONE_DAY),
+            GranularityRuntime(Granularity::TEN_SECONDS, RAW_FORMAT),
+            GranularityRuntime(Granularity::ONE_MINUTE, ROLLUP_FORMAT),
+            GranularityRuntime(Granularity::ONE_HOUR, ROLLUP_FORMAT),
+            GranularityRuntime(Granularity::ONE_DAY, ROLLUP_FORMAT),
         }};
+        // Samples seit dem letzten Eintrag in die jeweilige Granularitaet
+        std::array<RunningAggregate<T, N>, (size_t)Granularity::MAX> pending;
+        // nur im Worker: Abtastzeitpunkte (esp_timer) im aktuellen Rohdatensatz inkl. ausgefallener, Zeitpunkt des naechsten
+        // Rohdatensatzes (-1: noch keiner) und esp_timer-Zeit des zuletzt verarbeiteten Samples
+        uint32_t rawSlots{0};
+        int64_t nextRawEpoch{-1};
+        int64_t lastProcessedUs{0};
 
-        int16_t *inputs[4];
+        std::array<const T *, N> inputs;
 
-        static void timerCallback10secondsStatic(TimerHandle_t xTimer)
+        // laeuft im esp_timer-Task und darf ihn nicht aufhalten: nur Eingaenge lesen, einreihen, Worker wecken
+        static void sampleCallbackStatic(void *arg)
         {
-            M *myself = timeseries::M::GetSingleton();
-            myself->timerCallback10seconds();
+            static_cast<M *>(arg)->sampleCallback();
         }
 
-        ErrorCode GetTimeseries4096byte(Granularity g, int goBack, void *buf)
+        void sampleCallback()
         {
-            GranularityRuntime *rt = G(g);
-            rt->ReadFullSector4096bytes(partition, goBack, buf);
-            return ErrorCode::OK;
+            int64_t nowUs = esp_timer_get_time();
+            if (lastSampleUs != 0)
+            {
+                int64_t deviationUs = nowUs - lastSampleUs - (int64_t)samplePeriodMs * 1000;
+                uint32_t jitterUs = (uint32_t)(deviationUs < 0 ? -deviationUs : deviationUs);
+                samplingStats.jitterMaxUs = std::max(samplingStats.jitterMaxUs, jitterUs);
+                jitterSumUs += jitterUs;
+                jitterCount++;
+            }
+            lastSampleUs = nowUs;
+
+            QueuedSample q;
+            for (size_t i = 0; i < N; i++)
+                q.sample.values[i] = *this->inputs[i];
+            struct timeval tv_now;
+            gettimeofday(&tv_now, nullptr);
+            q.secondsEpoch = tv_now.tv_sec;
+            q.sampledUs = nowUs;
+            samplingStats.samples++;
+            if (!queue.Push(q))
+            {
+                samplingStats.dropped++;
+                return;
+            }
+            xTaskNotifyGive(worker);
+        }
+
+        void workerTask()
+        {
+            while (true)
+            {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                if (!xSemaphoreTake(semaphore, pdMS_TO_TICKS(1000)))
+                {
+                    ESP_LOGW(TAG, "Timeseries store busy, samples stay queued");
+                    continue;
+                }
+                processQueued();
+                xSemaphoreGive(semaphore);
+            }
+        }
+
+        // nur mit 'semaphore' aufrufen
+        void processQueued()
+        {
+            QueuedSample q;
+            while (queue.Pop(q))
+            {
+                samplingStats.workerLatencyMaxUs = std::max(samplingStats.workerLatencyMaxUs, (uint32_t)(esp_timer_get_time() - q.sampledUs));
+                process(q);
+            }
         }
 
         GranularityRuntime *G(Granularity gran)
@@ -236,38 +1121,175 @@ namespace timeseries
             return &granularityRuntime[(size_t)gran];
         }
 
-        void timerCallback10seconds()
+        // nur mit 'semaphore' aufrufen
+        template <typename RECORD>
+        void query(GranularityRuntime *rt, time_t fromEpoch, time_t toEpoch, uint32_t channelMask, QueryRowFn fn, void *ctx)
         {
-            struct timeval tv_now;
-            gettimeofday(&tv_now, nullptr);
-            time_t secondsEpoch = tv_now.tv_sec;
-            secondsEpoch = (secondsEpoch / 10) * 10; // runden auf volle 10s
-            // Suche Daten zusammen
-            FourSignals sigs;
-            for (int i = 0; i < 4; i++)
-                sigs.values[i] = *this->inputs[i];
-            G(Granularity::TEN_SECONDS)->Write(partition, secondsEpoch, &sigs);
-            if (G(Granularity::TEN_SECONDS)->writeCounter == 6)
+            const int64_t interval = rt->cfg->SECONDS_PER_RECORD;
+            // Binaersuche nach dem (zeitlich) ersten Sektor, der erst nach fromEpoch beginnt -- fromEpoch liegt dann im
+            // Sektor davor. Leere Sektoren (Zeitstempel -1) gibt es nur am alten Ende, die Ordnung bleibt also erhalten.
+            size_t lo{0};
+            size_t hi{rt->cfg->SECTOR_CNT};
+            while (lo < hi)
             {
-                secondsEpoch = (secondsEpoch / 60) * 60; // runden auf volle Minuten
-                G(Granularity::TEN_SECONDS)->AverageNReadingsAndResetWriteCounter(partition, 6, &sigs);
-                G(Granularity::ONE_MINUTE)->Write(partition, secondsEpoch, &sigs);
+                size_t mid = (lo + hi) / 2;
+                if (rt->SectorHeader(rt->PhysicalSector(mid))[0] <= fromEpoch)
+                    lo = mid + 1;
+                else
+                    hi = mid;
             }
-            if (G(Granularity::ONE_MINUTE)->writeCounter == 60)
+
+            QueryValue values[N]{};
+            for (size_t k = lo > 0 ? lo - 1 : 0; k < rt->cfg->SECTOR_CNT; k++)
             {
-                // TODO: Dieser Prozess muss laufen, wenn eine volle Stunde erreicht wurde und mindestens 15 MInuten-Readings existieren
-                G(Granularity::ONE_MINUTE)->AverageNReadingsAndResetWriteCounter(partition, 60, &sigs);
-                G(Granularity::ONE_HOUR)->Write(partition, secondsEpoch, &sigs);
+                size_t physical = rt->PhysicalSector(k);
+                const int64_t *hdr = rt->SectorHeader(physical);
+                if (hdr[0] == -1)
+                    continue;
+                if (hdr[0] > toEpoch)
+                    return;
+                if (!rt->IsOwnFormat(hdr))
+                {
+                    ESP_LOGW(TAG, "Sector %d has a different record format, skipping it in query", (int)physical);
+                    continue;
+                }
+                size_t first = fromEpoch > hdr[0] ? (fromEpoch - hdr[0] + interval - 1) / interval : 0;
+                size_t end = (size_t)((toEpoch - hdr[0]) / interval + 1);
+                bool goOn = rt->ForEachRecord(physical, first, end, [&](size_t index, const uint8_t *bytes)
+                                              {
+                                                  RECORD r;
+                                                  memcpy(&r, bytes, sizeof(RECORD));
+                                                  for (size_t c = 0; c < N; c++)
+                                                      if (channelMask & (1u << c))
+                                                          r.Get(c, &values[c]);
+                                                  return fn(ctx, hdr[0] + (int64_t)index * interval, channelMask, values, N); });
+                if (!goOn)
+                    return;
             }
-            if (G(Granularity::ONE_HOUR)->writeCounter == 24)
+        }
+
+        // nur mit 'semaphore' aufrufen; samplesPerRecord Abtastzeitpunkte ergeben einen Rohdatensatz. Bei voller
+        // Warteschlange verworfene Samples fehlen hier; sie werden am Abstand der esp_timer-Zeitstempel erkannt und zaehlen
+        // als Abtastzeitpunkt mit, damit jeder Rohdatensatz genau RAW_RECORD_PERIOD_MS abdeckt. Ein Rohdatensatz ganz ohne
+        // Samples wird nicht geschrieben -- Write ueberbrueckt die Luecke beim naechsten mit einem Fuellslot.
+        void process(const QueuedSample &q)
+        {
+            if (lastProcessedUs != 0)
+            {
+                const int64_t periodUs = (int64_t)samplePeriodMs * 1000;
+                int64_t lost = (q.sampledUs - lastProcessedUs + periodUs / 2) / periodUs - 1;
+                for (; lost > 0; lost--)
+                {
+                    if (++rawSlots == samplesPerRecord)
+                        finishRawRecord(q.secondsEpoch - (time_t)(lost * samplePeriodMs / 1000)); // Uhrzeit des ausgefallenen Samples
+                }
+            }
+            lastProcessedUs = q.sampledUs;
+            for (auto &p : pending)
+                p.Add(q.sample);
+            if (++rawSlots == samplesPerRecord)
+                finishRawRecord(q.secondsEpoch);
+        }
+
+        // Zeitpunkt eines Rohdatensatzes: fortlaufend im 10s-Raster, damit Zittern des Abtastzeitpunkts um eine 10s-Grenze
+        // keine Luecke vortaeuscht. Neu an der Uhr ausgerichtet wird beim ersten Datensatz und wenn die Uhr (SNTP, Nutzer)
+        // um mehr als einen Datensatzabstand springt.
+        void finishRawRecord(time_t nowEpoch)
+        {
+            constexpr int64_t interval = RAW_RECORD_PERIOD_MS / 1000;
+            rawSlots = 0;
+            int64_t offset = nowEpoch - nextRawEpoch;
+            if (nextRawEpoch < 0 || offset < -interval || offset >= 2 * interval)
+                nextRawEpoch = (nowEpoch / interval) * interval; // runden auf volle 10s
+            time_t secondsEpoch = nextRawEpoch;
+            nextRawEpoch += interval;
+            if (pending[(size_t)Granularity::TEN_SECONDS].count == 0)
+                return;
+            RawRecord raw = RawRecord::FromAggregate(pending[(size_t)Granularity::TEN_SECONDS]);
+            pending[(size_t)Granularity::TEN_SECONDS].Reset();
+            G(Granularity::TEN_SECONDS)->Write(partition, secondsEpoch, &raw);
+            // Rollover von fein nach grob; die Reihenfolge ist wichtig, weil der Minuten-Write erst den
+            // writeCounter hochzaehlt, der dann ggf. den Stunden-Rollover ausloest
+            for (size_t g = (size_t)Granularity::ONE_MINUTE; g < (size_t)Granularity::MAX; g++)
             {
-                // TODO: Die Tageslogik muss anders sein, weil ein Tag nicht immer nach 24h vorbei ist. Hier ist zu prüfen, ob es seit dem letzten Aufruf einen Tageswechsel gegeben hat und dann werden die letzten 23...25h zusammen gefasst
-                G(Granularity::ONE_HOUR)->AverageNReadingsAndResetWriteCounter(partition, 60, &sigs);
-                G(Granularity::ONE_DAY)->Write(partition, secondsEpoch, &sigs);
+                GranularityRuntime *finer = &granularityRuntime[g - 1];
+                GranularityRuntime *coarser = &granularityRuntime[g];
+                if (finer->writeCounter < coarser->cfg->HOW_MANY_READING_DO_I_NEED_FROM_PREVIOUS)
+                    break;
+                // Die Rollups sind bewusst zaehlbasiert: ein Datensatz der groeberen Stufe fasst genau
+                // HOW_MANY_READING_DO_I_NEED_FROM_PREVIOUS Datensaetze der feineren zusammen, unabhaengig von der Uhrzeit.
+                // Nach einem Neustart oder ausgefallenen Samples liegen die Grenzen deshalb nicht auf der vollen Stunde bzw.
+                // Mitternacht; der Zeitstempel (UTC, Sommerzeit spielt keine Rolle) ist das auf volle Minuten gerundete Ende.
+                time_t rolloverEpoch = (secondsEpoch / 60) * 60; // runden auf volle Minuten
+                RollupRecord rollup = RollupRecord::FromAggregate(pending[g]);
+                pending[g].Reset();
+                finer->writeCounter = 0;
+                coarser->Write(partition, rolloverEpoch, &rollup);
             }
         }
 
     public:
+        // Schreibt alle im RAM gesammelten Samples ins Flash. Wird automatisch vor esp_restart() aufgerufen
+        // (esp_register_shutdown_handler); Anwendungen mit eigener Unterspannungserkennung (frueh ausloesender
+        // Komparator, Supercap) rufen es zusaetzlich von dort auf -- der ESP-IDF-Brownout-Handler selbst ruft
+        // keine Shutdown-Handler und darf auch nicht mehr ins Flash schreiben.
+        ErrorCode Flush()
+        {
+            if (!partition)
+                return ErrorCode::OK;
+            RETURN_ERRORCODE_ON_FALSE(xSemaphoreTake(semaphore, pdMS_TO_TICKS(1000)), ErrorCode::GENERIC_ERROR, "Timeseries store busy, could not flush");
+            processQueued();
+            for (auto &rt : granularityRuntime)
+                rt.Flush(partition);
+            xSemaphoreGive(semaphore);
+            return ErrorCode::OK;
+        }
+
+        ErrorCode Query(Granularity g, time_t fromEpoch, time_t toEpoch, uint32_t channelMask, QueryRowFn fn, void *ctx) override
+        {
+            RETURN_ERRORCODE_ON_FALSE(partition && g < Granularity::MAX && fromEpoch <= toEpoch && fn, ErrorCode::GENERIC_ERROR, "Invalid timeseries query");
+            RETURN_ERRORCODE_ON_FALSE(xSemaphoreTake(semaphore, pdMS_TO_TICKS(1000)), ErrorCode::GENERIC_ERROR, "Timeseries store busy");
+            if (g == Granularity::TEN_SECONDS)
+                query<RawRecord>(G(g), fromEpoch, toEpoch, channelMask, fn, ctx);
+            else
+                query<RollupRecord>(G(g), fromEpoch, toEpoch, channelMask, fn, ctx);
+            xSemaphoreGive(semaphore);
+            return ErrorCode::OK;
+        }
+
+        RecordFormat GetRecordFormat(Granularity g) override
+        {
+            return G(g)->format;
+        }
+
+        ErrorCode GetFlashHealth(FlashHealth &health) override
+        {
+            RETURN_ERRORCODE_ON_FALSE(partition, ErrorCode::GENERIC_ERROR, "Timeseries store not initialized");
+            RETURN_ERRORCODE_ON_FALSE(xSemaphoreTake(semaphore, pdMS_TO_TICKS(1000)), ErrorCode::GENERIC_ERROR, "Timeseries store busy");
+            health = {};
+            health.secondsObserved = (uint32_t)((esp_timer_get_time() - initUs) / 1000000);
+            health.yearsLeft = -1;
+            for (size_t g = 0; g < (size_t)Granularity::MAX; g++)
+            {
+                GranularityHealth &h = health.granularities[g];
+                h = granularityRuntime[g].GetHealth(health.secondsObserved);
+                health.writesPerDay += h.writesPerDay;
+                health.erasesPerDay += h.erasesPerDay;
+                if (h.yearsLeft >= 0 && (health.yearsLeft < 0 || h.yearsLeft < health.yearsLeft))
+                    health.yearsLeft = h.yearsLeft;
+            }
+            xSemaphoreGive(semaphore);
+            return ErrorCode::OK;
+        }
+
+        SamplingStats GetSamplingStats() override
+        {
+            SamplingStats stats = samplingStats;
+            stats.periodMs = samplePeriodMs;
+            stats.jitterMeanUs = jitterCount ? (uint32_t)(jitterSumUs / jitterCount) : 0;
+            return stats;
+        }
+
         static M *GetSingleton()
         {
             if (!singleton)
@@ -277,35 +1299,69 @@ namespace timeseries
             return singleton;
         }
 
-        
-        ErrorCode Init(int16_t *timeseries0, int16_t *timeseries1, int16_t *timeseries2, int16_t *timeseries3)
+        // 'inputs' zeigt auf die N Variablen, deren Wert alle 'samplePeriodMs' abgetastet wird. Die Periode muss
+        // RAW_RECORD_PERIOD_MS (10s) ganzzahlig teilen; ein Rohdatensatz ist dann der Mittelwert aller Samples seiner
+        // 10s, Min/Max der Roll-ups gehen ueber alle Samples. Abgetastet wird in einem esp_timer-Callback, der nur
+        // einreiht -- die Flash-Arbeit (Staging, Write, Erase) macht ein eigener Task niedriger Prioritaet und haelt
+        // damit weder den esp_timer- noch den FreeRTOS-Timer-Task auf.
+        ErrorCode Init(const std::array<const T *, N> &inputs, uint32_t samplePeriodMs = RAW_RECORD_PERIOD_MS)
         {
             if (semaphore != nullptr)
             {
                 ESP_LOGE(TAG, "webmanager already started");
                 return ErrorCode::GENERIC_ERROR;
             }
+            RETURN_ERRORCODE_ON_FALSE(samplePeriodMs >= MIN_SAMPLE_PERIOD_MS && RAW_RECORD_PERIOD_MS % samplePeriodMs == 0, ErrorCode::GENERIC_ERROR, "Sample period %lums does not divide %lums", (unsigned long)samplePeriodMs, (unsigned long)RAW_RECORD_PERIOD_MS);
+            this->samplePeriodMs = samplePeriodMs;
+            this->samplesPerRecord = RAW_RECORD_PERIOD_MS / samplePeriodMs;
             // TODO: check realtime available!
+
+            // erst in lokale Variablen: 'partition' gilt bei Flush/Query/GetFlashHealth als "initialisiert" und darf
+            // erst gesetzt werden, wenn auch die Einblendung steht; ein fehlgeschlagenes Init kann wiederholt werden
+            const esp_partition_t *found = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "timeseries");
+            RETURN_ERRORCODE_ON_FALSE(found, ErrorCode::GENERIC_ERROR, "No Partition Found");
+            RETURN_ERRORCODE_ON_FALSE(found->size >= SECTOR_SIZE_BYTES * SECTORS_TOTAL, ErrorCode::GENERIC_ERROR, "Partition too small, need %d bytes", (int)(SECTOR_SIZE_BYTES * SECTORS_TOTAL));
+            // Die Partition wird einmalig eingeblendet (128k = 2-3 MMU-Seiten) und bleibt es; alle Lesezugriffe (Query)
+            // gehen ohne Zwischenpuffer direkt auf den Flash
+            const void *mapped{nullptr};
+            RETURN_ERRORCODE_ON_FALSE(esp_partition_mmap(found, 0, SECTOR_SIZE_BYTES * SECTORS_TOTAL, ESP_PARTITION_MMAP_DATA, &mapped, &mmapHandle) == ESP_OK, ErrorCode::GENERIC_ERROR, "Could not mmap timeseries partition");
+
             semaphore = xSemaphoreCreateBinary();
             xSemaphoreGive(semaphore);
-
-            this->partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "timeseries");
-            RETURN_ERRORCODE_ON_FALSE(this->partition, ErrorCode::GENERIC_ERROR, "No Partition Found");
+            this->partition = found;
             for (int i = 0; i < (size_t)Granularity::MAX; i++)
-                this->granularityRuntime[i].Init(this->partition);
+                this->granularityRuntime[i].Init(this->partition, static_cast<const uint8_t *>(mapped));
+            for (size_t g = 0; g + 1 < (size_t)Granularity::MAX; g++)
+                this->granularityRuntime[g].RestoreWriteCounter(this->granularityRuntime[g + 1]);
+            initUs = esp_timer_get_time();
 
-            inputs[0] = timeseries0;
-            inputs[1] = timeseries1;
-            inputs[2] = timeseries2;
-            inputs[3] = timeseries3;
+            this->inputs = inputs;
 
-            tmr = xTimerCreate("Timeseries", pdMS_TO_TICKS(10000), pdTRUE, this, timerCallback10secondsStatic);
-            RETURN_ERRORCODE_ON_FALSE(xTimerStart(tmr, 10), ErrorCode::GENERIC_ERROR, "Timer start error");
+            if (!initialized)
+                ESP_ERROR_CHECK(esp_register_shutdown_handler([]()
+                                                              { initialized->Flush(); }));
+            initialized = this;
+
+            RETURN_ERRORCODE_ON_FALSE(xTaskCreate([](void *arg)
+                                                  { static_cast<M *>(arg)->workerTask(); }, "timeseries", WORKER_STACK_SIZE, this, WORKER_PRIORITY, &worker) == pdPASS,
+                                      ErrorCode::GENERIC_ERROR, "Could not create timeseries worker");
+            esp_timer_create_args_t timerArgs{};
+            timerArgs.callback = sampleCallbackStatic;
+            timerArgs.arg = this;
+            timerArgs.dispatch_method = ESP_TIMER_TASK;
+            timerArgs.name = "timeseries";
+            timerArgs.skip_unhandled_events = true;
+            RETURN_ERRORCODE_ON_FALSE(esp_timer_create(&timerArgs, &sampleTimer) == ESP_OK, ErrorCode::GENERIC_ERROR, "Timer create error");
+            RETURN_ERRORCODE_ON_FALSE(esp_timer_start_periodic(sampleTimer, (uint64_t)samplePeriodMs * 1000) == ESP_OK, ErrorCode::GENERIC_ERROR, "Timer start error");
             return ErrorCode::OK;
         }
     };
     
-    timeseries::M* M::singleton;
+    template <typename T, size_t N, RecordLayout ROLLUP_LAYOUT, SectorCodec CODEC>
+    M<T, N, ROLLUP_LAYOUT, CODEC> *M<T, N, ROLLUP_LAYOUT, CODEC>::singleton{nullptr};
+
+    template <typename T, size_t N, RecordLayout ROLLUP_LAYOUT, SectorCodec CODEC>
+    M<T, N, ROLLUP_LAYOUT, CODEC> *M<T, N, ROLLUP_LAYOUT, CODEC>::initialized{nullptr};
 }
 
 #undef TAG
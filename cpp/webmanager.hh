@@ -27,6 +27,7 @@
 #include <lwip/api.h>
 #include <lwip/netdb.h>
 #include <lwip/ip4_addr.h>
+#include <lwip/sockets.h>
 #include <driver/gpio.h>
 #include <nvs.h>
 #include <spi_flash_mmap.h>
@@ -44,11 +45,14 @@
 #error "Enable Websocket support for HTTPD in menuconfig"
 #endif
 #include "esp_vfs.h"
+#include "webmanager_sessions.hh"
+#include "webmanager_dispatch.hh"
+#include "webmanager_receiver.hh"
 
 #define TAG "WMAN"
 #include "webmanager_constants.hh"
 #include "webmanager_interfaces.hh"
-#include "webmanager_async_response.hh"
+#include "webmanager_frame_pool.hh"
 #include "wsprotocol_cpp/ws_protocol.hh"
 
 namespace webmanager
@@ -76,7 +80,10 @@ namespace webmanager
         TimerHandle_t timSupervisor{nullptr};
 
         httpd_handle_t http_server{nullptr};
-        int websocket_file_descriptor{-1};
+        FramePool framePool;
+        WsSessionTable sessions{&framePool, this};
+        WsDispatchTable dispatch;
+        WsReceiver receiver{&dispatch};
         std::string auth_username{""};
         std::string auth_password{""};
         std::string session_token{""};
@@ -182,7 +189,7 @@ namespace webmanager
             resp.rssi = 0;
             uint8_t buf[256];
             size_t len = WsProtocol::wifimanager::ResponseWifiConnect::Encode(resp, buf, sizeof(buf));
-            ESP_LOGI(TAG, "sendWifiConnectionNotSuccessfulMessage: requestId=%d, encoded len=%d, fd=%d", (int)resp.requestId, (int)len, (int)websocket_file_descriptor);
+            ESP_LOGI(TAG, "sendWifiConnectionNotSuccessfulMessage: requestId=%d, encoded len=%d, sessions=%d", (int)resp.requestId, (int)len, (int)sessions.Count());
             if (len > 0)
             {
                 esp_err_t ret = SendRawAsync(buf, len);
@@ -211,7 +218,7 @@ namespace webmanager
             resp.rssi = ap.rssi;
             uint8_t buf[256];
             size_t len = WsProtocol::wifimanager::ResponseWifiConnect::Encode(resp, buf, sizeof(buf));
-            ESP_LOGI(TAG, "sendWifiConnectionSuccessfulMessage: requestId=%d, ssid='%s', ip=%s, encoded len=%d, fd=%d", (int)resp.requestId, resp.ssid, ip4addr_ntoa((const ip4_addr_t*)&ip->ip), (int)len, (int)websocket_file_descriptor);
+            ESP_LOGI(TAG, "sendWifiConnectionSuccessfulMessage: requestId=%d, ssid='%s', ip=%s, encoded len=%d, sessions=%d", (int)resp.requestId, resp.ssid, ip4addr_ntoa((const ip4_addr_t*)&ip->ip), (int)len, (int)sessions.Count());
             if (len > 0)
             {
                 esp_err_t ret = SendRawAsync(buf, len);
@@ -449,56 +456,13 @@ namespace webmanager
             // LogJournal(messagecodes::C::SNTP, esp_timer_get_time() / 1000);
         }
 
-        static void ws_async_send(void *arg)
-        {
-            M *myself = M::GetSingleton();
-            AsyncResponse *a = static_cast<AsyncResponse *>(arg);
-            assert(a);
-            assert(a->buffer);
-            assert(a->buffer_len);
-            assert(myself);
-            if (myself->http_server && myself->websocket_file_descriptor != -1)
-            {
-                httpd_ws_frame_t ws_pkt = {false, false, HTTPD_WS_TYPE_BINARY, a->buffer, a->buffer_len};
-                esp_err_t ret = httpd_ws_send_frame_async(myself->http_server, myself->websocket_file_descriptor, &ws_pkt);
-                if (ret == ESP_OK)
-                {
-                    ESP_LOGD(TAG, "httpd_ws_send_frame_async: data_len:%u\n", ws_pkt.len);
-                }
-                else
-                {
-                    ESP_LOGW(TAG, "httpd_ws_send_frame_async failed (0x%x). Invalidating websocket session fd %d", (unsigned int)ret, myself->websocket_file_descriptor);
-                    httpd_sess_trigger_close(myself->http_server, myself->websocket_file_descriptor);
-                    myself->websocket_file_descriptor = -1;
-                }
-                // should be syncronous. So the buffer can be deleted, when the function returns
-            }
-            delete a;
-        }
-
         void close_active_websocket_before_ap_shutdown()
         {
-            if (!http_server || websocket_file_descriptor == -1)
+            if (!http_server)
             {
                 return;
             }
-
-            const int ws_fd = websocket_file_descriptor;
-
-            if (httpd_ws_get_fd_info(http_server, ws_fd) == HTTPD_WS_CLIENT_WEBSOCKET)
-            {
-                uint8_t close_payload[2] = {0x03, 0xE8}; // 1000 = normal closure
-                httpd_ws_frame_t close_pkt = {false, false, HTTPD_WS_TYPE_CLOSE, close_payload, sizeof(close_payload)};
-                esp_err_t send_ret = httpd_ws_send_frame_async(http_server, ws_fd, &close_pkt);
-                if (send_ret != ESP_OK)
-                {
-                    ESP_LOGW(TAG, "Failed to send websocket close frame to fd %d (%d)", ws_fd, send_ret);
-                }
-            }
-
-            httpd_sess_trigger_close(http_server, ws_fd);
-            websocket_file_descriptor = -1;
-            ESP_LOGI(TAG, "Closed active websocket session fd %d before AP shutdown", ws_fd);
+            sessions.CloseAll();
         }
 
         esp_err_t handle_webmanager_ws(httpd_req_t *req)
@@ -515,7 +479,15 @@ namespace webmanager
                     return ESP_FAIL;
                 }
                 
-                ESP_LOGI(TAG, "WebSocket connection authenticated and opened (fd=%d)", (int)httpd_req_to_sockfd(req));
+                int fd = httpd_req_to_sockfd(req);
+                // Ohne close_fn der Anwendung kann unter diesem fd noch die Session eines laengst geschlossenen
+                // Tabs stehen (fd wiederverwendet) -- die gehoert nicht zu diesem Handshake.
+                onSocketClosed(fd);
+                if (!sessions.Register(fd))
+                {
+                    return ESP_FAIL;
+                }
+                ESP_LOGI(TAG, "WebSocket connection authenticated and opened (fd=%d, sessions=%d)", fd, (int)sessions.Count());
                 return ESP_OK;
             }
 
@@ -523,95 +495,41 @@ namespace webmanager
             httpd_resp_set_hdr(req, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
             httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
 
-            httpd_ws_frame_t ws_pkt = {false, false, HTTPD_WS_TYPE_BINARY, nullptr, 0};
-
-            // always store the last websocket file descriptor
-            this->websocket_file_descriptor = httpd_req_to_sockfd(req);
-
-            /* Set max_len = 0 to get the frame len */
-            esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
-            if (ret != ESP_OK)
-            {
-                // Bad/malformed websocket frames can happen during disconnect/AP transitions.
-                // Never abort the device from this callback.
-                if (ret == ESP_ERR_INVALID_STATE)
-                {
-                    ESP_LOGW(TAG, "Ignoring websocket frame in invalid state (%d)", ret);
-                    return ESP_OK;
-                }
-                ESP_LOGW(TAG, "httpd_ws_recv_frame(header) failed with %d", ret);
-                return ret;
-            }
-            if (ws_pkt.len == 0 || ws_pkt.type != HTTPD_WS_TYPE_BINARY)
-            {
-                ESP_LOGE(TAG, "Received an empty or an non binary websocket frame");
-                return ESP_OK;
-            }
-            uint8_t *buf = new uint8_t[ws_pkt.len];
-            assert(buf);
-            ws_pkt.payload = buf;
-            ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
+            // Antworten gehen ueber die Session des anfragenden Tabs (Unicast), nicht mehr an den
+            // zuletzt aktiven Tab. Register liefert die beim Handshake angelegte Session und legt sie
+            // nur neu an, falls sie zwischenzeitlich nach einem Sendefehler verworfen wurde.
+            WsSession *session = sessions.Register(httpd_req_to_sockfd(req));
+            return receiver.Receive(req, session);
+        }
 
-            if (ret != ESP_OK)
-            {
-                ESP_LOGE(TAG, "httpd_ws_recv_frame failed with %d", ret);
-                delete[] buf;
-                return ret;
-            }
-            if (ws_pkt.len < 4)
-            {
-                ESP_LOGW(TAG, "Ignoring short websocket binary frame (len=%u)", (unsigned)ws_pkt.len);
-                delete[] buf;
-                return ESP_OK;
-            }
-            uint16_t namespaceId = (uint16_t)(buf[0] | (buf[1] << 8));
-            uint16_t messageTypeId = (uint16_t)(buf[2] | (buf[3] << 8));
-            eMessageReceiverResult success = ProvideWebsocketMessage(this, req, &ws_pkt, namespaceId, messageTypeId, buf, ws_pkt.len);
-            if (success == eMessageReceiverResult::NOT_FOR_ME && plugins)
-            {
-                for (auto p : *plugins)
-                {
-                    success = p->ProvideWebsocketMessage(this, req, &ws_pkt, namespaceId, messageTypeId, buf, ws_pkt.len);
-                    if (success != eMessageReceiverResult::NOT_FOR_ME)
-                    {
-                        break;
-                    }
-                }
-            }
-            if (success == eMessageReceiverResult::NOT_FOR_ME)
-            {
-                ESP_LOGW(TAG, "Not yet implemented request for namespace %u, neither internal nor in a plugin", (unsigned)namespaceId);
-            }
-            else if (success == eMessageReceiverResult::FOR_ME_BUT_FAILED)
+        // Einziger Aufraeum-Pfad fuer einen geschlossenen Socket, egal ob httpd ihn ueber HttpdCloseFn meldet
+        // oder der Handshake einen wiederverwendeten fd vorfindet.
+        void onSocketClosed(int fd)
+        {
+            receiver.OnSocketClosed(fd);
+            WsSession *session = sessions.Find(fd);
+            if (session && this->plugins)
             {
-                ESP_LOGW(TAG, "Request for namespace %u has been implemented by plugin, but processing failed", (unsigned)namespaceId);
+                for (auto p : *this->plugins)
+                    p->OnSessionClosed(session);
             }
-            delete[] buf;
-            return ESP_OK;
+            sessions.Unregister(fd);
         }
 
         // wifimanager wird hier direkt (nicht ueber den generischen 'plugins'-Vektor) behandelt,
-        // weil es eng mit der WLAN-State-Machine dieser Klasse verzahnt ist -- funktional aber ein
-        // regulaerer iWebmanagerPlugin-Aufruf wie jeder andere Namespace, kein Sonderfall im
-        // Dispatcher mehr (anders als vorher).
-        eMessageReceiverResult ProvideWebsocketMessage(iWebmanagerCallback *callback, httpd_req_t *req, httpd_ws_frame_t *ws_pkt, uint16_t namespaceId, uint16_t messageTypeId, const uint8_t *frame, size_t frameLen)
+        // weil es eng mit der WLAN-State-Machine dieser Klasse verzahnt ist -- die drei Requests
+        // landen als gewoehnliche Eintraege in der Dispatch-Tabelle, kein Sonderfall im Dispatcher.
+        void registerWifimanagerHandlers()
         {
-            if (namespaceId != WsProtocol::wifimanager::NAMESPACE_ID)
-                return eMessageReceiverResult::NOT_FOR_ME;
-            switch (messageTypeId)
-            {
-            case WsProtocol::wifimanager::RequestNetworkInformation::TYPE_ID:
-                return sendResponseNetworkInformation(frame, frameLen);
-            case WsProtocol::wifimanager::RequestWifiConnect::TYPE_ID:
-                return handleRequestWifiConnect(frame, frameLen);
-            case WsProtocol::wifimanager::RequestWifiDisconnect::TYPE_ID:
-                return handleRequestWifiDisconnect(frame, frameLen);
-            default:
-                return eMessageReceiverResult::FOR_ME_BUT_FAILED;
-            }
+            dispatch.RegisterHandler(WsProtocol::wifimanager::NAMESPACE_ID, WsProtocol::wifimanager::RequestNetworkInformation::TYPE_ID, [](void *ctx, iWebmanagerCallback *callback, const uint8_t *frame, size_t frameLen)
+                                     { return static_cast<M *>(ctx)->sendResponseNetworkInformation(callback, frame, frameLen); }, this);
+            dispatch.RegisterHandler(WsProtocol::wifimanager::NAMESPACE_ID, WsProtocol::wifimanager::RequestWifiConnect::TYPE_ID, [](void *ctx, iWebmanagerCallback *callback, const uint8_t *frame, size_t frameLen)
+                                     { return static_cast<M *>(ctx)->handleRequestWifiConnect(callback, frame, frameLen); }, this);
+            dispatch.RegisterHandler(WsProtocol::wifimanager::NAMESPACE_ID, WsProtocol::wifimanager::RequestWifiDisconnect::TYPE_ID, [](void *ctx, iWebmanagerCallback *callback, const uint8_t *frame, size_t frameLen)
+                                     { return static_cast<M *>(ctx)->handleRequestWifiDisconnect(callback, frame, frameLen); }, this);
         }
 
-        eMessageReceiverResult handleRequestWifiConnect(const uint8_t *frame, size_t frameLen)
+        eMessageReceiverResult handleRequestWifiConnect(iWebmanagerCallback *callback, const uint8_t *frame, size_t frameLen)
         {
             WsProtocol::wifimanager::RequestWifiConnect::Payload req{};
             if (!WsProtocol::wifimanager::RequestWifiConnect::Decode(frame, frameLen, req))
@@ -650,11 +568,11 @@ namespace webmanager
                 resp.rssi = 0;
                 uint8_t buf[256];
                 size_t n = WsProtocol::wifimanager::ResponseWifiConnect::Encode(resp, buf, sizeof(buf));
-                return (n > 0 && SendRawAsync(buf, n) == ESP_OK) ? eMessageReceiverResult::OK : eMessageReceiverResult::FOR_ME_BUT_FAILED;
+                return (n > 0 && callback->SendRawAsync(buf, n) == ESP_OK) ? eMessageReceiverResult::OK : eMessageReceiverResult::FOR_ME_BUT_FAILED;
             }
         }
 
-        eMessageReceiverResult handleRequestWifiDisconnect(const uint8_t *frame, size_t frameLen)
+        eMessageReceiverResult handleRequestWifiDisconnect(iWebmanagerCallback *callback, const uint8_t *frame, size_t frameLen)
         {
             WsProtocol::wifimanager::RequestWifiDisconnect::Payload req{};
             if (!WsProtocol::wifimanager::RequestWifiDisconnect::Decode(frame, frameLen, req))
@@ -664,7 +582,7 @@ namespace webmanager
             resp.requestId = req.requestId;
             uint8_t buf[64];
             size_t len = WsProtocol::wifimanager::ResponseWifiDisconnect::Encode(resp, buf, sizeof(buf));
-            if (len > 0) SendRawAsync(buf, len);
+            if (len > 0) callback->SendRawAsync(buf, len);
             vTaskDelay(pdMS_TO_TICKS(2000)); // warte 2s, um die Beantwortung des Requests noch zu ermöglichen
 
             if (!xSemaphoreTake(webmanager_semaphore, portMAX_DELAY))
@@ -677,7 +595,7 @@ namespace webmanager
             return eMessageReceiverResult::OK;
         }
 
-        eMessageReceiverResult sendResponseNetworkInformation(const uint8_t *frame, size_t frameLen)
+        eMessageReceiverResult sendResponseNetworkInformation(iWebmanagerCallback *callback, const uint8_t *frame, size_t frameLen)
         {
             WsProtocol::wifimanager::RequestNetworkInformation::Payload req{};
             if (!WsProtocol::wifimanager::RequestNetworkInformation::Decode(frame, frameLen, req))
@@ -743,9 +661,10 @@ namespace webmanager
                 resp.accesspointsCount = ap_appended;
                 resp.accesspointsDataSize = ap_scratch_pos;
 
-                uint8_t buf[1536];
-                size_t len = WsProtocol::wifimanager::ResponseNetworkInformation::Encode(resp, buf, sizeof(buf));
-                ret = (len > 0 && SendRawAsync(buf, len) == ESP_OK) ? ESP_OK : ESP_FAIL;
+                PooledFrame *f = callback->ReserveFrame(1536);
+                if (!f) return eMessageReceiverResult::FOR_ME_BUT_FAILED;
+                size_t len = WsProtocol::wifimanager::ResponseNetworkInformation::Encode(resp, f->buffer, f->capacity);
+                ret = callback->CommitFrame(f, len) == ESP_OK ? ESP_OK : ESP_FAIL;
             }
             return ret == ESP_OK ? eMessageReceiverResult::OK : eMessageReceiverResult::FOR_ME_BUT_FAILED;
         }
@@ -1291,6 +1210,19 @@ namespace webmanager
         }
 
     public:
+        // Fuer httpd_config_t::close_fn (bzw. httpd_ssl_config_t::httpd.close_fn) der Anwendung, die den Server
+        // startet und ihn an RegisterHTTPDHandlers uebergibt. Meldet das Schliessen eines Sockets, damit dessen
+        // Websocket-Session sofort aus der Tabelle verschwindet und ein wiederverwendeter fd (ggf. ein reiner
+        // HTTP-Socket) keine Websocket-Frames bekommt. Wie von httpd fuer close_fn verlangt, schliesst die
+        // Funktion den Socket selbst.
+        static void HttpdCloseFn(httpd_handle_t hd, int sockfd)
+        {
+            (void)(hd);
+            if (singleton)
+                singleton->onSocketClosed(sockfd);
+            close(sockfd);
+        }
+
         static M *GetSingleton()
         {
             if (!singleton)
@@ -1331,29 +1263,97 @@ namespace webmanager
             return seconds_epoch > 1684412222; // epoch time when this code has been written
         }
 
+        // Broadcast an alle offenen Websocket-Sessions (ein geteilter Frame, s. WsSessionTable::Broadcast).
+        // Antworten auf Requests laufen dagegen ueber die WsSession, die der Dispatcher als 'callback'
+        // durchreicht (Unicast an den anfragenden Tab).
         esp_err_t SendRawAsync(const uint8_t* data, size_t len) override
         {
             if (!http_server)
                 return ESP_FAIL;
-            if (websocket_file_descriptor == -1)
+            if (sessions.Count() == 0)
             {
-                ESP_LOGD(TAG, "SendRawAsync: no active websocket connection (fd==-1), dropping %d bytes", (int)len);
+                ESP_LOGD(TAG, "SendRawAsync: no active websocket connection, dropping %d bytes", (int)len);
                 return ESP_ERR_INVALID_STATE;
             }
-            auto *a = new AsyncResponse(data, len);
-            esp_err_t ret = httpd_queue_work(http_server, M::ws_async_send, a);
-            if (ret != ESP_OK)
+            PooledFrame *f = ReserveFrame(len);
+            if (!f)
+                return ESP_ERR_NO_MEM;
+            std::memcpy(f->buffer, data, len);
+            return CommitFrame(f, len);
+        }
+
+        // Unicast an genau eine Session, z.B. fuer Plugins, die sich den Socket eines Requests gemerkt haben.
+        esp_err_t SendRawAsyncTo(int fd, const uint8_t* data, size_t len)
+        {
+            WsSession *session = sessions.Find(fd);
+            if (!session)
+                return ESP_ERR_INVALID_STATE;
+            return session->SendRawAsync(data, len);
+        }
+
+        PooledFrame *ReserveFrame(size_t maxLen) override
+        {
+            PooledFrame *f = framePool.Reserve(maxLen);
+            if (!f)
             {
-                ESP_LOGW(TAG, "SendRawAsync: httpd_queue_work failed with %s (fd=%d)", esp_err_to_name(ret), (int)websocket_file_descriptor);
-                delete (a);
-                if (ret == ESP_ERR_INVALID_ARG || ret == ESP_FAIL)
-                {
-                    websocket_file_descriptor = -1;
-                }
+                ESP_LOGW(TAG, "ReserveFrame: frame pool exhausted for %d bytes", (int)maxLen);
+            }
+            return f;
+        }
+
+        esp_err_t CommitFrame(PooledFrame *f, size_t len) override
+        {
+            if (!f)
+                return ESP_ERR_INVALID_ARG;
+            if (len == 0 || len > f->capacity)
+            {
+                framePool.Release(f);
+                return ESP_ERR_INVALID_SIZE;
+            }
+            if (!http_server)
+            {
+                framePool.Release(f);
+                return ESP_FAIL;
+            }
+            f->len = len;
+            esp_err_t ret = sessions.Broadcast(f);
+            if (ret == ESP_ERR_INVALID_STATE)
+            {
+                ESP_LOGD(TAG, "CommitFrame: no active websocket connection, dropping %d bytes", (int)len);
             }
             return ret;
         }
 
+        FramePoolStats GetFramePoolStats() override
+        {
+            return framePool.GetStats();
+        }
+
+        void SetSendPolicy(uint16_t namespaceId, uint16_t messageTypeId, eSendPolicy policy) override
+        {
+            sessions.SetSendPolicy(namespaceId, messageTypeId, policy);
+        }
+
+        WsSendStats GetWebsocketSendStats() override
+        {
+            return sessions.GetSendStats();
+        }
+
+        WsReceiveStats GetWebsocketReceiveStats() override
+        {
+            return receiver.GetStats();
+        }
+
+        esp_err_t RegisterMessageHandler(uint16_t namespaceId, uint16_t messageTypeId, MessageHandlerFn handler, void *ctx) override
+        {
+            return dispatch.RegisterHandler(namespaceId, messageTypeId, handler, ctx);
+        }
+
+        esp_err_t RegisterStreamHandler(uint16_t namespaceId, uint16_t messageTypeId, StreamHandlerFn handler, void *ctx) override
+        {
+            return dispatch.RegisterStreamHandler(namespaceId, messageTypeId, handler, ctx);
+        }
+
         void RegisterHTTPDHandlers(httpd_handle_t httpd_handle)
         {
             httpd_uri_t files_get = {
@@ -1417,6 +1417,7 @@ namespace webmanager
                 { return static_cast<M *>(req->user_ctx)->handle_webmanager_get(req); },
                 this, false, false, nullptr};
             ESP_ERROR_CHECK(httpd_register_uri_handler(httpd_handle, &webmanager_get));
+            this->sessions.SetServer(httpd_handle);
             this->http_server = httpd_handle;
         }
 
@@ -1451,6 +1452,11 @@ namespace webmanager
             }
 
             this->plugins = plugins;
+            registerWifimanagerHandlers();
+            for (auto p : *this->plugins)
+            {
+                dispatch.AddPlugin(p);
+            }
 
             // Create and check netifs
             wifi_netif_sta = esp_netif_create_default_wifi_sta();
@@ -1528,6 +1534,12 @@ namespace webmanager
                 this->setStatus(WorkingState::KEEP_CONNECTION, now_us + COMMON_TIMEOUT_US);
             }
             ESP_ERROR_CHECK(esp_wifi_start());
+            // Standard-Sendestrategien der bekannten Push-Nachrichten; Plugins koennen in OnBegin ueberschreiben.
+            // Ein erkannter Finger darf nie verloren gehen, CAN-Telegramme sind ein Strom, bei dem nur die
+            // juengsten interessieren, und vom Heizungsexperiment zaehlt nur der aktuelle Zustand.
+            SetSendPolicy(WsProtocol::fingerprint::NAMESPACE_ID, WsProtocol::fingerprint::NotifyFingerDetected::TYPE_ID, eSendPolicy::MUST_DELIVER);
+            SetSendPolicy(WsProtocol::canmonitor::NAMESPACE_ID, WsProtocol::canmonitor::NotifyCanMessage::TYPE_ID, eSendPolicy::DROP_OLDEST);
+            SetSendPolicy(WsProtocol::heaterexperiment::NAMESPACE_ID, WsProtocol::heaterexperiment::ResponseHeater::TYPE_ID, eSendPolicy::COALESCE_LATEST);
             for (const auto &i : *this->plugins)
             {
                 i->OnBegin(this);
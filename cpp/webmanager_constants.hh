@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <cstring>
 #include <ctime>
+#include <array>
 #include <esp_wifi.h>
 
 namespace webmanager{
@@ -22,6 +23,32 @@ namespace webmanager{
     constexpr const char* FILES_GLOB{"/files/*"};
     constexpr const size_t FILES_BASE_PATH_LEN{6};
 
+    // Websocket-Sendepfad: fester Frame-Pool statt new/delete je Nachricht (s. webmanager_frame_pool.hh).
+    // Groesste Klasse muss den groessten Response (ResponseSystemData, ResponseSchedulerList) fassen.
+    constexpr size_t FRAME_POOL_SIZE_CLASSES{4};
+    constexpr std::array<size_t, FRAME_POOL_SIZE_CLASSES> FRAME_POOL_SLOT_SIZES{{64, 256, 1536, 4096}};
+    constexpr std::array<size_t, FRAME_POOL_SIZE_CLASSES> FRAME_POOL_SLOT_COUNTS{{16, 8, 4, 2}};
+    constexpr size_t FRAME_POOL_TOTAL_SLOTS{FRAME_POOL_SLOT_COUNTS[0] + FRAME_POOL_SLOT_COUNTS[1] + FRAME_POOL_SLOT_COUNTS[2] + FRAME_POOL_SLOT_COUNTS[3]};
+    constexpr size_t FRAME_POOL_SLAB_SIZE{FRAME_POOL_SLOT_SIZES[0] * FRAME_POOL_SLOT_COUNTS[0] + FRAME_POOL_SLOT_SIZES[1] * FRAME_POOL_SLOT_COUNTS[1] + FRAME_POOL_SLOT_SIZES[2] * FRAME_POOL_SLOT_COUNTS[2] + FRAME_POOL_SLOT_SIZES[3] * FRAME_POOL_SLOT_COUNTS[3]};
+
+    // Mehrere gleichzeitig geoeffnete Browser-Tabs: begrenzte Session-Tabelle, je Session ein Ring
+    // ausstehender Frames (s. webmanager_sessions.hh).
+    constexpr size_t WS_MAX_SESSIONS{4};
+    constexpr size_t WS_SESSION_QUEUE_LEN{8};
+    constexpr size_t WS_MAX_SEND_POLICIES{16};
+    // Ein einzelner Sendefehler auf wackeligem WLAN schliesst die Session nicht mehr sofort
+    constexpr uint8_t WS_MAX_CONSECUTIVE_SEND_ERRORS{3};
+
+    // Dispatch eingehender Frames (s. webmanager_dispatch.hh): namespaceIds < WS_DISPATCH_NAMESPACE_SLOTS
+    // werden direkt indiziert, groessere und Plugins ohne festen Namespace laufen ueber die lineare Liste.
+    constexpr size_t WS_DISPATCH_NAMESPACE_SLOTS{32};
+    constexpr size_t WS_DISPATCH_MAX_HANDLERS{48};
+    constexpr uint16_t WS_NAMESPACE_ANY{0xFFFF};
+
+    // Empfangspfad: ein einmalig allokierter Empfangspuffer statt new[] je Frame. Groessere Frames werden
+    // abgewiesen, groessere Nachrichten muessen fragmentiert an einen Streaming-Handler gehen.
+    constexpr size_t WS_RX_ARENA_SIZE{4096};
+
     #define _(n) n
     enum class WorkingState{//bezieht sich auf den State, der zuletzt erreicht wurde (also nicht der, der als nächstes erreicht werden soll)
         #include "webmanager_workingstate.inc"
@@ -0,0 +1,194 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <vector>
+#include <freertos/FreeRTOS.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_http_server.h>
+#include "webmanager_constants.hh"
+#include "webmanager_interfaces.hh"
+
+#define TAG "WSDISP"
+
+namespace webmanager
+{
+    // Verteilt eingehende Websocket-Frames anhand des 4-Byte-Kopfes. Bisher wurde fuer jeden Frame jedes
+    // Plugin der Reihe nach per virtuellem ProvideWebsocketMessage gefragt, das dann selbst seine
+    // namespaceId verglichen hat -- bei 10+ Namespaces pro Frame 10+ virtuelle Aufrufe. Jetzt:
+    //  1. Handler, die per RegisterHandler fuer genau (namespaceId, messageTypeId) eingetragen wurden, werden
+    //     direkt aufgerufen (kein switch im Plugin). Die Handler eines Namespace liegen zusammenhaengend im
+    //     'handlers'-Array, der Namespace-Slot kennt Anfang und Anzahl.
+    //  2. Sonst das Plugin, das per GetNamespaceId() genau diesen Namespace angemeldet hat (ein Aufruf).
+    //  3. Sonst wie bisher linear alle Plugins mit WS_NAMESPACE_ANY (oder namespaceId >= WS_DISPATCH_NAMESPACE_SLOTS).
+    // Die Plugins sind Laufzeitobjekte (Vektor aus main), eine constexpr-Tabelle ist deshalb nicht moeglich;
+    // die Tabelle wird einmalig in M::Begin befuellt und danach nur noch gelesen. Registrierungen aus
+    // OnBegin koennen aber bereits parallel zum httpd-Task laufen, deshalb der kurze Spinlock.
+    class WsDispatchTable
+    {
+    private:
+        struct HandlerEntry
+        {
+            uint16_t namespaceId;
+            uint16_t messageTypeId;
+            MessageHandlerFn fn;
+            StreamHandlerFn streamFn;
+            void *ctx;
+        };
+
+        struct NamespaceSlot
+        {
+            iWebmanagerPlugin *plugin;
+            uint8_t firstHandler;
+            uint8_t handlerCount;
+        };
+
+        std::array<NamespaceSlot, WS_DISPATCH_NAMESPACE_SLOTS> slots{};
+        std::array<HandlerEntry, WS_DISPATCH_MAX_HANDLERS> handlers{};
+        size_t handlerCount{0};
+        std::vector<iWebmanagerPlugin *> fallback;
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+        // nur unter 'lock' aufrufen; Einfuegen sortiert nach namespaceId, damit die Handler je Namespace zusammenhaengend bleiben
+        void rebuildSlotsLocked()
+        {
+            for (auto &slot : slots)
+            {
+                slot.firstHandler = 0;
+                slot.handlerCount = 0;
+            }
+            for (size_t i = 0; i < handlerCount; i++)
+            {
+                NamespaceSlot &slot = slots[handlers[i].namespaceId];
+                if (slot.handlerCount == 0)
+                    slot.firstHandler = i;
+                slot.handlerCount++;
+            }
+        }
+
+        esp_err_t registerEntry(uint16_t namespaceId, uint16_t messageTypeId, MessageHandlerFn fn, StreamHandlerFn streamFn, void *ctx)
+        {
+            if ((!fn && !streamFn) || namespaceId >= WS_DISPATCH_NAMESPACE_SLOTS)
+            {
+                ESP_LOGE(TAG, "Cannot register handler for %u/%u (namespace slots: %d)", namespaceId, messageTypeId, (int)WS_DISPATCH_NAMESPACE_SLOTS);
+                return ESP_ERR_INVALID_ARG;
+            }
+            portENTER_CRITICAL(&lock);
+            size_t pos{0};
+            while (pos < handlerCount && handlers[pos].namespaceId <= namespaceId)
+            {
+                if (handlers[pos].namespaceId == namespaceId && handlers[pos].messageTypeId == messageTypeId)
+                {
+                    handlers[pos].fn = fn;
+                    handlers[pos].streamFn = streamFn;
+                    handlers[pos].ctx = ctx;
+                    portEXIT_CRITICAL(&lock);
+                    return ESP_OK;
+                }
+                pos++;
+            }
+            if (handlerCount == WS_DISPATCH_MAX_HANDLERS)
+            {
+                portEXIT_CRITICAL(&lock);
+                ESP_LOGE(TAG, "Handler table full (%d entries), cannot register %u/%u", (int)WS_DISPATCH_MAX_HANDLERS, namespaceId, messageTypeId);
+                return ESP_ERR_NO_MEM;
+            }
+            for (size_t i = handlerCount; i > pos; i--)
+                handlers[i] = handlers[i - 1];
+            handlers[pos] = {namespaceId, messageTypeId, fn, streamFn, ctx};
+            handlerCount++;
+            rebuildSlotsLocked();
+            portEXIT_CRITICAL(&lock);
+            return ESP_OK;
+        }
+
+    public:
+        esp_err_t RegisterHandler(uint16_t namespaceId, uint16_t messageTypeId, MessageHandlerFn fn, void *ctx)
+        {
+            return registerEntry(namespaceId, messageTypeId, fn, nullptr, ctx);
+        }
+
+        esp_err_t RegisterStreamHandler(uint16_t namespaceId, uint16_t messageTypeId, StreamHandlerFn fn, void *ctx)
+        {
+            return registerEntry(namespaceId, messageTypeId, nullptr, fn, ctx);
+        }
+
+        // true, wenn fuer (namespaceId, messageTypeId) ein Streaming-Handler eingetragen ist
+        bool FindStreamHandler(uint16_t namespaceId, uint16_t messageTypeId, StreamHandlerFn &fn, void *&ctx)
+        {
+            fn = nullptr;
+            ctx = nullptr;
+            if (namespaceId >= WS_DISPATCH_NAMESPACE_SLOTS)
+                return false;
+            portENTER_CRITICAL(&lock);
+            const NamespaceSlot &slot = slots[namespaceId];
+            for (size_t i = slot.firstHandler; i < slot.firstHandler + slot.handlerCount; i++)
+            {
+                if (handlers[i].messageTypeId == messageTypeId)
+                {
+                    fn = handlers[i].streamFn;
+                    ctx = handlers[i].ctx;
+                    break;
+                }
+            }
+            portEXIT_CRITICAL(&lock);
+            return fn != nullptr;
+        }
+
+        void AddPlugin(iWebmanagerPlugin *plugin)
+        {
+            uint16_t namespaceId = plugin->GetNamespaceId();
+            if (namespaceId < WS_DISPATCH_NAMESPACE_SLOTS)
+            {
+                portENTER_CRITICAL(&lock);
+                iWebmanagerPlugin *previous = slots[namespaceId].plugin;
+                if (!previous)
+                    slots[namespaceId].plugin = plugin;
+                portEXIT_CRITICAL(&lock);
+                if (!previous)
+                    return;
+                ESP_LOGW(TAG, "Namespace %u is served by more than one plugin, falling back to linear dispatch for the second one", namespaceId);
+            }
+            fallback.push_back(plugin);
+        }
+
+        eMessageReceiverResult Dispatch(iWebmanagerCallback *callback, httpd_req_t *req, httpd_ws_frame_t *ws_pkt, uint16_t namespaceId, uint16_t messageTypeId, const uint8_t *frame, size_t frameLen)
+        {
+            if (namespaceId < WS_DISPATCH_NAMESPACE_SLOTS)
+            {
+                MessageHandlerFn fn{nullptr};
+                void *ctx{nullptr};
+                portENTER_CRITICAL(&lock);
+                const NamespaceSlot &slot = slots[namespaceId];
+                for (size_t i = slot.firstHandler; i < slot.firstHandler + slot.handlerCount; i++)
+                {
+                    if (handlers[i].messageTypeId == messageTypeId && handlers[i].fn)
+                    {
+                        fn = handlers[i].fn;
+                        ctx = handlers[i].ctx;
+                        break;
+                    }
+                }
+                iWebmanagerPlugin *plugin = slot.plugin;
+                portEXIT_CRITICAL(&lock);
+                if (fn)
+                    return fn(ctx, callback, frame, frameLen);
+                if (plugin)
+                {
+                    eMessageReceiverResult res = plugin->ProvideWebsocketMessage(callback, req, ws_pkt, namespaceId, messageTypeId, frame, frameLen);
+                    if (res != eMessageReceiverResult::NOT_FOR_ME)
+                        return res;
+                }
+            }
+            for (auto p : fallback)
+            {
+                eMessageReceiverResult res = p->ProvideWebsocketMessage(callback, req, ws_pkt, namespaceId, messageTypeId, frame, frameLen);
+                if (res != eMessageReceiverResult::NOT_FOR_ME)
+                    return res;
+            }
+            return eMessageReceiverResult::NOT_FOR_ME;
+        }
+    };
+}
+#undef TAG
@@ -0,0 +1,142 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <freertos/FreeRTOS.h>
+#include "webmanager_constants.hh"
+
+namespace webmanager
+{
+    // Verhalten eines Frames, wenn der Sende-Ring einer Session voll ist (langsamer Client, schlechtes
+    // WLAN). Wird je (namespaceId, messageTypeId) festgelegt, s. iWebmanagerCallback::SetSendPolicy.
+    enum class eSendPolicy : uint8_t
+    {
+        MUST_DELIVER = 0,    // verdraengt notfalls den aeltesten verwerfbaren Frame, wird selbst nie verworfen
+        DROP_OLDEST = 1,     // bei vollem Ring wird der aelteste verwerfbare Frame verworfen
+        COALESCE_LATEST = 2, // ein noch nicht gesendeter Frame gleichen Typs und gleichen coalesceKey wird ersetzt
+        MAX = 3,
+    };
+
+    // Ein Fach aus dem FramePool. 'buffer' zeigt fest in den einmalig beim Start allokierten Slab und
+    // wird nie umgehaengt -- Plugins encodieren per <Namespace>::<Message>::Encode(payload, f->buffer,
+    // f->capacity) direkt hinein und uebergeben den Frame per CommitFrame() an den httpd-Task (ersetzt
+    // die vormalige AsyncResponse, die fuer jede Nachricht new[]+memcpy gemacht hat).
+    struct PooledFrame
+    {
+        uint8_t *buffer;
+        size_t capacity;
+        size_t len;
+        uint8_t sizeClass;
+        uint8_t refCount;  // Anzahl Session-Sende-Ringe, die den Frame noch referenzieren (Broadcast teilt EINEN Frame)
+        eSendPolicy policy;   // wird beim Commit aus der Policy-Tabelle gesetzt
+        uint32_t coalesceKey; // optional vor CommitFrame setzen, unterscheidet bei COALESCE_LATEST z.B. CAN-IDs
+        PooledFrame *next; // Verkettung der Free-List, nur gueltig solange der Frame frei ist
+    };
+
+    struct FramePoolStats
+    {
+        std::array<uint16_t, FRAME_POOL_SIZE_CLASSES> inUse;
+        std::array<uint16_t, FRAME_POOL_SIZE_CLASSES> highWater;
+        std::array<uint32_t, FRAME_POOL_SIZE_CLASSES> reserveFailures; // Klasse passend, aber kein Fach mehr frei
+        uint32_t oversizeRequests;                                     // groesser als die groesste Klasse
+        uint32_t reserves;                                             // erfolgreiche Reserve()-Aufrufe, ~ Allokationen je Nachricht
+    };
+
+    // Slab mit festen Groessenklassen (s. FRAME_POOL_SLOT_SIZES/FRAME_POOL_SLOT_COUNTS). Bei Erschoepfung
+    // wird bewusst NICHT auf malloc ausgewichen -- Reserve() liefert nullptr und zaehlt mit, damit sich
+    // der Heap ueber Wochen Laufzeit nicht mehr fragmentiert. Reserve/Release duerfen aus beliebigen
+    // Tasks aufgerufen werden (kurzer kritischer Abschnitt, keine blockierenden Aufrufe darin).
+    class FramePool
+    {
+    private:
+        uint8_t *slab{nullptr};
+        std::array<PooledFrame, FRAME_POOL_TOTAL_SLOTS> frames;
+        std::array<PooledFrame *, FRAME_POOL_SIZE_CLASSES> freeList{};
+        FramePoolStats stats{};
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+    public:
+        FramePool()
+        {
+            slab = new uint8_t[FRAME_POOL_SLAB_SIZE];
+            size_t frameIndex{0};
+            size_t slabOffset{0};
+            for (size_t c = 0; c < FRAME_POOL_SIZE_CLASSES; c++)
+            {
+                for (size_t i = 0; i < FRAME_POOL_SLOT_COUNTS[c]; i++)
+                {
+                    PooledFrame *f = &frames[frameIndex++];
+                    f->buffer = slab + slabOffset;
+                    f->capacity = FRAME_POOL_SLOT_SIZES[c];
+                    f->len = 0;
+                    f->sizeClass = c;
+                    f->refCount = 0;
+                    f->policy = eSendPolicy::MUST_DELIVER;
+                    f->coalesceKey = 0;
+                    f->next = freeList[c];
+                    freeList[c] = f;
+                    slabOffset += FRAME_POOL_SLOT_SIZES[c];
+                }
+            }
+        }
+
+        // Liefert das kleinste freie Fach mit capacity>=minCapacity. Ist die passende Klasse leer, wird
+        // in die naechstgroessere ausgewichen (kostet nur Pool-Platz, keinen Heap).
+        PooledFrame *Reserve(size_t minCapacity)
+        {
+            size_t c = 0;
+            while (c < FRAME_POOL_SIZE_CLASSES && FRAME_POOL_SLOT_SIZES[c] < minCapacity)
+                c++;
+            portENTER_CRITICAL(&lock);
+            if (c == FRAME_POOL_SIZE_CLASSES)
+            {
+                stats.oversizeRequests++;
+                portEXIT_CRITICAL(&lock);
+                return nullptr;
+            }
+            const size_t requestedClass = c;
+            while (c < FRAME_POOL_SIZE_CLASSES && freeList[c] == nullptr)
+                c++;
+            if (c == FRAME_POOL_SIZE_CLASSES)
+            {
+                stats.reserveFailures[requestedClass]++;
+                portEXIT_CRITICAL(&lock);
+                return nullptr;
+            }
+            PooledFrame *f = freeList[c];
+            freeList[c] = f->next;
+            f->next = nullptr;
+            f->len = 0;
+            f->refCount = 0;
+            f->policy = eSendPolicy::MUST_DELIVER;
+            f->coalesceKey = 0;
+            stats.inUse[c]++;
+            stats.reserves++;
+            stats.highWater[c] = std::max(stats.highWater[c], stats.inUse[c]);
+            portEXIT_CRITICAL(&lock);
+            return f;
+        }
+
+        void Release(PooledFrame *f)
+        {
+            if (!f)
+                return;
+            portENTER_CRITICAL(&lock);
+            f->len = 0;
+            f->next = freeList[f->sizeClass];
+            freeList[f->sizeClass] = f;
+            stats.inUse[f->sizeClass]--;
+            portEXIT_CRITICAL(&lock);
+        }
+
+        FramePoolStats GetStats()
+        {
+            portENTER_CRITICAL(&lock);
+            FramePoolStats copy = stats;
+            portEXIT_CRITICAL(&lock);
+            return copy;
+        }
+    };
+}
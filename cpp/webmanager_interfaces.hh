@@ -5,6 +5,8 @@
 #include <cstddef>
 #include <string>
 #include <vector>
+#include <array>
+#include "webmanager_frame_pool.hh"
 
 namespace webmanager
 {
@@ -15,6 +17,39 @@ namespace webmanager
         FOR_ME_BUT_FAILED,
     };
 
+    struct WsSendStats
+    {
+        uint16_t activeSessions;
+        uint16_t queueHighWater; // hoechster Fuellstand eines Session-Sende-Rings seit Start
+        uint32_t coalesced;      // durch einen neueren Frame gleichen Schluessels ersetzte Frames
+        std::array<uint32_t, (size_t)eSendPolicy::MAX> dropped; // verworfene Frames je Policy des verworfenen Frames
+        uint32_t sendErrors;     // fehlgeschlagene httpd_ws_send_frame_async-Aufrufe
+        uint32_t sentFrames;
+        uint32_t sentBytes;
+        uint64_t sendTimeTotalUs; // Summe der Dauer von httpd_ws_send_frame_async im httpd-Task
+        uint32_t sendTimeMaxUs;
+    };
+
+    struct WsReceiveStats
+    {
+        uint32_t frames;         // gelesene Frames inkl. Fragmente
+        uint32_t bytes;
+        uint32_t oversizeFrames; // abgewiesen, weil groesser als WS_RX_ARENA_SIZE
+        uint32_t dispatched;     // an einen Handler/ein Plugin verteilte Nachrichten bzw. Streaming-Chunks
+        uint64_t dispatchTimeTotalUs; // Summe der Handler-Laufzeiten (inkl. Decode und Encode der Antwort)
+        uint32_t dispatchTimeMaxUs;
+    };
+
+    class iWebmanagerCallback;
+
+    // Handler fuer genau einen (namespaceId, messageTypeId); 'ctx' ist der bei der Registrierung
+    // uebergebene Zeiger (typischerweise 'this' des Plugins, Aufruf aus einem captureless Lambda).
+    typedef eMessageReceiverResult (*MessageHandlerFn)(void *ctx, iWebmanagerCallback *callback, const uint8_t *frame, size_t frameLen);
+    // Streaming-Handler fuer fragmentiert (Websocket-Continuation-Frames) gesendete grosse Nachrichten: wird je
+    // Fragment aufgerufen, 'offset' ist die Position von 'chunk' in der Gesamtnachricht (der erste Chunk beginnt
+    // mit dem 4-Byte-Kopf), 'last' markiert das letzte Fragment. Die Gesamtnachricht wird nie am Stueck gepuffert.
+    typedef eMessageReceiverResult (*StreamHandlerFn)(void *ctx, iWebmanagerCallback *callback, const uint8_t *chunk, size_t chunkLen, size_t offset, bool last);
+
     class iWebmanagerCallback
     {
     public:
@@ -24,6 +59,27 @@ namespace webmanager
         // WrapAndSendAsync(uint32_t, FlatBufferBuilder&) vollstaendig -- kein Plugin baut mehr
         // Flatbuffers-Antworten.
         virtual esp_err_t SendRawAsync(const uint8_t* data, size_t len) = 0;
+        // Zero-Copy-Variante von SendRawAsync: ReserveFrame liefert ein Fach aus dem Frame-Pool (oder
+        // nullptr, wenn der Pool erschoepft ist -- kein Ausweichen auf malloc), in das direkt per
+        // <Namespace>::<Message>::Encode(payload, f->buffer, f->capacity) encodiert wird. CommitFrame
+        // uebernimmt das Fach in JEDEM Fall (auch im Fehlerfall und bei len==0) und gibt es nach dem
+        // Senden im httpd-Task selbst an den Pool zurueck.
+        virtual PooledFrame* ReserveFrame(size_t maxLen) = 0;
+        virtual esp_err_t CommitFrame(PooledFrame* frame, size_t len) = 0;
+        virtual FramePoolStats GetFramePoolStats() = 0;
+        // Ueberschreibt die Sendestrategie fuer einen Nachrichtentyp (Standard: MUST_DELIVER), typischerweise
+        // aus iWebmanagerPlugin::OnBegin heraus.
+        virtual void SetSendPolicy(uint16_t namespaceId, uint16_t messageTypeId, eSendPolicy policy) = 0;
+        virtual WsSendStats GetWebsocketSendStats() = 0;
+        virtual WsReceiveStats GetWebsocketReceiveStats() = 0;
+        // Registriert einen Handler direkt fuer (namespaceId, messageTypeId) -- der Dispatcher ruft ihn ohne
+        // Umweg ueber ProvideWebsocketMessage und dessen switch auf. Nur ueber den in OnBegin erhaltenen
+        // Callback moeglich (nicht ueber die Session eines Requests).
+        virtual esp_err_t RegisterMessageHandler(uint16_t namespaceId, uint16_t messageTypeId, MessageHandlerFn handler, void *ctx) = 0;
+        virtual esp_err_t RegisterStreamHandler(uint16_t namespaceId, uint16_t messageTypeId, StreamHandlerFn handler, void *ctx) = 0;
+        // Kennung des Tabs hinter diesem Callback; wechselt mit jeder neuen Websocket-Verbindung, auch wenn die
+        // Session (und damit der Zeiger) wiederverwendet wird. 0 fuer den Broadcast-Callback aus OnBegin.
+        virtual uint32_t GetSessionId() { return 0; }
     };
 
     class iWebmanagerPlugin
@@ -33,6 +89,12 @@ namespace webmanager
         virtual void OnWifiConnect(iWebmanagerCallback *callback) = 0;
         virtual void OnWifiDisconnect(iWebmanagerCallback *callback) = 0;
         virtual void OnTimeUpdate(iWebmanagerCallback *callback)=0;
+        // Namespace, den dieses Plugin bedient. Der Dispatcher legt das Plugin damit beim Begin in einen direkt
+        // indizierten Slot; WS_NAMESPACE_ANY (Standard) fuehrt weiterhin zum linearen Durchprobieren.
+        virtual uint16_t GetNamespaceId() { return WS_NAMESPACE_ANY; }
+        // Der Tab hinter 'session' wurde geschlossen (Aufruf aus dem httpd-Task, GetSessionId ist noch die des
+        // geschlossenen Tabs). Plugins, die sich Sessions merken, muessen sie hier vergessen.
+        virtual void OnSessionClosed(iWebmanagerCallback *session) { (void)(session); }
         // 'frame' zeigt auf den KOMPLETTEN eingehenden Frame inkl. 4-Byte-Kopf (namespaceId/
         // messageTypeId sind bereits vom Dispatcher geparst und werden hier zusaetzlich
         // mitgegeben) -- passend zu den generierten <Namespace>::<Message>::Decode(data, len,
@@ -40,9 +102,34 @@ namespace webmanager
         virtual eMessageReceiverResult ProvideWebsocketMessage(iWebmanagerCallback *callback, httpd_req_t *req, httpd_ws_frame_t *ws_pkt, uint16_t namespaceId, uint16_t messageTypeId, const uint8_t *frame, size_t frameLen) = 0;
     };
 
+    // Verweis auf ein Schedule, den iScheduler::ResolveSchedule einmalig aus dem Namen aufloest: 'index' ist der
+    // Platz in der flachen Timer-Tabelle des Schedulers, 'generation' zaehlt die Belegungen dieses Platzes. Ein
+    // Umbenennen oder Ueberschreiben (Save unter gleichem Namen) laesst den Handle gueltig, ein Loeschen macht ihn
+    // ungueltig -- auch dann, wenn der Platz spaeter von einem anderen Schedule wiederverwendet wird.
+    struct ScheduleHandle
+    {
+        uint16_t index;
+        uint16_t generation;
+    };
+    constexpr ScheduleHandle INVALID_SCHEDULE_HANDLE{UINT16_MAX, 0};
+
+    // Benachrichtigung ueber einen Wertwechsel eines abonnierten Schedules. Aufruf aus dem Task, der
+    // Scheduler::Loop aufruft; einmalig beim Abonnieren mit dem aktuellen Wert aus dem Task des Abonnenten.
+    typedef void (*ScheduleChangedFn)(void *ctx, ScheduleHandle handle, uint16_t value);
+
     class iScheduler{
     public:
+        // Bequemlichkeitsfassung fuer seltene Abfragen; ungekannte Namen liefern 0
         virtual uint16_t GetCurrentValueOfSchedule(const char* schedulerName)=0;
+        // INVALID_SCHEDULE_HANDLE, wenn es kein Schedule dieses Namens gibt
+        virtual ScheduleHandle ResolveSchedule(const char* schedulerName)=0;
+        // Schneller Pfad ohne Strings; ein ungueltiger (geloeschter) Handle liefert 0 wie ein unbekannter Name
+        virtual uint16_t GetCurrentValue(ScheduleHandle handle)=0;
+        virtual bool IsValid(ScheduleHandle handle)=0;
+        // Push statt Polling; ein Abonnement endet mit dem Loeschen des Schedules, ein Umbenennen uebersteht es.
+        // ESP_ERR_NOT_FOUND bei ungueltigem Handle, ESP_ERR_NO_MEM bei voller Abonnententabelle.
+        virtual esp_err_t Subscribe(ScheduleHandle handle, ScheduleChangedFn fn, void *ctx)=0;
+        virtual esp_err_t Unsubscribe(ScheduleHandle handle, ScheduleChangedFn fn, void *ctx)=0;
         // Ersetzt das vormalige, Flatbuffers-spezifische FillFlatbufferWithAvailableNames(
         // FlatBufferBuilder&, vector<Offset<String>>&) -- Aufrufer (z.B. fingerprint) bauen ihre
         // eigene wire-Repraesentation selbst aus den Klartext-Namen.
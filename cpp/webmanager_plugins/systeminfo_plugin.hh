@@ -2,6 +2,7 @@
 
 #include "webmanager_interfaces.hh"
 #include "wsprotocol_cpp/ws_protocol.hh"
+#include "timeseries.hh"
 #include <driver/temperature_sensor.h>
 #define TAG "SYSINFO"
 
@@ -9,6 +10,7 @@ class SystemInfoPlugin : public webmanager::iWebmanagerPlugin
 {
 private:
     temperature_sensor_handle_t tempHandle{nullptr};
+    timeseries::iTimeseries *timeseriesStore{nullptr};
 
     static WsProtocol::systeminfo::Mac6 ReadMac(esp_mac_type_t type)
     {
@@ -102,13 +104,123 @@ private:
         resp.partitionsCount = partitions_count;
         resp.partitionsDataSize = partitions_pos;
 
-        static uint8_t buf[4096];
-        size_t len = WsProtocol::systeminfo::ResponseSystemData::Encode(resp, buf, sizeof(buf));
+        webmanager::PooledFrame *f = callback->ReserveFrame(4096);
+        if (!f)
+            return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+        size_t len = WsProtocol::systeminfo::ResponseSystemData::Encode(resp, f->buffer, f->capacity);
+        return callback->CommitFrame(f, len) == ESP_OK ? webmanager::eMessageReceiverResult::OK : webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+    }
+
+    webmanager::eMessageReceiverResult sendResponseWebsocketStatistics(webmanager::iWebmanagerCallback *callback, uint16_t requestId)
+    {
+        webmanager::FramePoolStats stats = callback->GetFramePoolStats();
+        uint8_t classes_scratch[webmanager::FRAME_POOL_SIZE_CLASSES * 16];
+        size_t classes_pos = 0;
+        size_t classes_count = 0;
+        for (size_t c = 0; c < webmanager::FRAME_POOL_SIZE_CLASSES; c++)
+        {
+            WsProtocol::systeminfo::FramePoolClass::Payload item{};
+            item.slotSize = webmanager::FRAME_POOL_SLOT_SIZES[c];
+            item.slotCount = webmanager::FRAME_POOL_SLOT_COUNTS[c];
+            item.inUse = stats.inUse[c];
+            item.highWater = stats.highWater[c];
+            item.reserveFailures = stats.reserveFailures[c];
+            size_t newPos = WsProtocol::systeminfo::AppendResponseWebsocketStatisticsPoolClassesFramePoolClassElement(item, classes_scratch, classes_pos, sizeof(classes_scratch));
+            if (newPos > 0)
+            {
+                classes_pos = newPos;
+                classes_count++;
+            }
+        }
+
+        WsProtocol::systeminfo::ResponseWebsocketStatistics::Payload resp{};
+        resp.requestId = requestId;
+        resp.oversizeRequests = stats.oversizeRequests;
+        webmanager::WsSendStats send = callback->GetWebsocketSendStats();
+        resp.activeSessions = send.activeSessions;
+        resp.queueHighWater = send.queueHighWater;
+        resp.coalesced = send.coalesced;
+        resp.droppedMustDeliver = send.dropped[(size_t)webmanager::eSendPolicy::MUST_DELIVER];
+        resp.droppedDropOldest = send.dropped[(size_t)webmanager::eSendPolicy::DROP_OLDEST];
+        resp.droppedCoalesceLatest = send.dropped[(size_t)webmanager::eSendPolicy::COALESCE_LATEST];
+        resp.sendErrors = send.sendErrors;
+        resp.txFrames = send.sentFrames;
+        resp.txBytes = send.sentBytes;
+        resp.sendTimeTotalUs = send.sendTimeTotalUs;
+        resp.sendTimeMaxUs = send.sendTimeMaxUs;
+        webmanager::WsReceiveStats rx = callback->GetWebsocketReceiveStats();
+        resp.rxFrames = rx.frames;
+        resp.rxBytes = rx.bytes;
+        resp.rxOversizeFrames = rx.oversizeFrames;
+        resp.dispatched = rx.dispatched;
+        resp.dispatchTimeTotalUs = rx.dispatchTimeTotalUs;
+        resp.dispatchTimeMaxUs = rx.dispatchTimeMaxUs;
+        resp.poolReserves = stats.reserves;
+        resp.poolClassesData = classes_scratch;
+        resp.poolClassesCount = classes_count;
+        resp.poolClassesDataSize = classes_pos;
+
+        uint8_t buf[256];
+        size_t len = WsProtocol::systeminfo::ResponseWebsocketStatistics::Encode(resp, buf, sizeof(buf));
+        return (len > 0 && callback->SendRawAsync(buf, len) == ESP_OK) ? webmanager::eMessageReceiverResult::OK : webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+    }
+
+    webmanager::eMessageReceiverResult sendResponseTimeseriesHealth(webmanager::iWebmanagerCallback *callback, uint16_t requestId)
+    {
+        if (!timeseriesStore)
+            return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+        timeseries::FlashHealth health;
+        if (timeseriesStore->GetFlashHealth(health) != ErrorCode::OK)
+            return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+
+        uint8_t granularities_scratch[(size_t)timeseries::Granularity::MAX * 32];
+        size_t granularities_pos = 0;
+        size_t granularities_count = 0;
+        for (size_t g = 0; g < (size_t)timeseries::Granularity::MAX; g++)
+        {
+            const timeseries::GranularityHealth &h = health.granularities[g];
+            WsProtocol::systeminfo::TimeseriesGranularityHealth::Payload item{};
+            item.granularity = (uint8_t)g;
+            item.sectorCount = h.sectorCount;
+            item.minEraseCount = h.minEraseCount;
+            item.maxEraseCount = h.maxEraseCount;
+            item.writesPerDay = h.writesPerDay;
+            item.erasesPerDay = h.erasesPerDay;
+            item.yearsLeft = h.yearsLeft;
+            size_t newPos = WsProtocol::systeminfo::AppendResponseTimeseriesHealthGranularitiesTimeseriesGranularityHealthElement(item, granularities_scratch, granularities_pos, sizeof(granularities_scratch));
+            if (newPos > 0)
+            {
+                granularities_pos = newPos;
+                granularities_count++;
+            }
+        }
+
+        WsProtocol::systeminfo::ResponseTimeseriesHealth::Payload resp{};
+        resp.requestId = requestId;
+        resp.eraseEndurance = timeseries::FLASH_ERASE_ENDURANCE;
+        resp.secondsObserved = health.secondsObserved;
+        resp.writesPerDay = health.writesPerDay;
+        resp.erasesPerDay = health.erasesPerDay;
+        resp.yearsLeft = health.yearsLeft;
+        resp.granularitiesData = granularities_scratch;
+        resp.granularitiesCount = granularities_count;
+        resp.granularitiesDataSize = granularities_pos;
+        timeseries::SamplingStats sampling = timeseriesStore->GetSamplingStats();
+        resp.samplePeriodMs = sampling.periodMs;
+        resp.samples = sampling.samples;
+        resp.samplesDropped = sampling.dropped;
+        resp.jitterMaxUs = sampling.jitterMaxUs;
+        resp.jitterMeanUs = sampling.jitterMeanUs;
+        resp.workerLatencyMaxUs = sampling.workerLatencyMaxUs;
+
+        uint8_t buf[256];
+        size_t len = WsProtocol::systeminfo::ResponseTimeseriesHealth::Encode(resp, buf, sizeof(buf));
         return (len > 0 && callback->SendRawAsync(buf, len) == ESP_OK) ? webmanager::eMessageReceiverResult::OK : webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
     }
 
 public:
-    SystemInfoPlugin(temperature_sensor_handle_t tempHandle):tempHandle(tempHandle)
+    // timeseriesStore: optional, ohne ihn wird RequestTimeseriesHealth mit FOR_ME_BUT_FAILED beantwortet
+    SystemInfoPlugin(temperature_sensor_handle_t tempHandle, timeseries::iTimeseries *timeseriesStore = nullptr) : tempHandle(tempHandle), timeseriesStore(timeseriesStore)
     {
     }
 
@@ -120,6 +232,7 @@ public:
     void OnWifiConnect(webmanager::iWebmanagerCallback *callback) override { (void)(callback); }
     void OnWifiDisconnect(webmanager::iWebmanagerCallback *callback) override { (void)(callback); }
     void OnTimeUpdate(webmanager::iWebmanagerCallback *callback) override { (void)(callback); }
+    uint16_t GetNamespaceId() override { return WsProtocol::systeminfo::NAMESPACE_ID; }
     webmanager::eMessageReceiverResult ProvideWebsocketMessage(webmanager::iWebmanagerCallback *callback, httpd_req_t *req, httpd_ws_frame_t *ws_pkt, uint16_t namespaceId, uint16_t messageTypeId, const uint8_t *frame, size_t frameLen) override
     {
         if (namespaceId != WsProtocol::systeminfo::NAMESPACE_ID)
@@ -140,6 +253,22 @@ public:
                 return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
             return sendResponseSystemData(callback, req.requestId);
         }
+
+        case WsProtocol::systeminfo::RequestWebsocketStatistics::TYPE_ID:
+        {
+            WsProtocol::systeminfo::RequestWebsocketStatistics::Payload req{};
+            if (!WsProtocol::systeminfo::RequestWebsocketStatistics::Decode(frame, frameLen, req))
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            return sendResponseWebsocketStatistics(callback, req.requestId);
+        }
+
+        case WsProtocol::systeminfo::RequestTimeseriesHealth::TYPE_ID:
+        {
+            WsProtocol::systeminfo::RequestTimeseriesHealth::Payload req{};
+            if (!WsProtocol::systeminfo::RequestTimeseriesHealth::Decode(frame, frameLen, req))
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            return sendResponseTimeseriesHealth(callback, req.requestId);
+        }
         default:
             return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
         }
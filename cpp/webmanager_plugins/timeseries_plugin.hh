@@ -0,0 +1,119 @@
+#pragma once
+
+#include "webmanager_interfaces.hh"
+#include "wsprotocol_cpp/ws_protocol.hh"
+#include "timeseries.hh"
+#define TAG "TSPLUGIN"
+
+// Beantwortet RequestTimeseries ueber timeseries::iTimeseries::Query. Die Antworten werden erst nach Rueckkehr
+// dieses Handlers im httpd-Task gesendet -- eine Anfrage erzeugt deshalb genau EIN Antwort-Frame (ein 1536er-Fach
+// des Frame-Pools) statt beliebig vieler, die den Pool leeren wuerden. Passt der Bereich nicht hinein, setzt der
+// Client die Abfrage ab NextFromEpoch fort.
+class TimeseriesPlugin : public webmanager::iWebmanagerPlugin
+{
+private:
+    static constexpr size_t VALUES_SCRATCH_SIZE{1400};
+
+    timeseries::iTimeseries *store;
+    // nur im httpd-Task benutzt, also nie gleichzeitig
+    uint8_t valuesScratch[VALUES_SCRATCH_SIZE];
+    size_t valuesPos{0};
+    size_t valuesCount{0};
+    int64_t nextFromEpoch{-1};
+
+    // haengt eine Zeile (alle angeforderten Kanaele eines Zeitpunkts) an; passt sie nicht mehr, wird sie ganz
+    // zurueckgenommen und die Abfrage beendet
+    static bool appendRow(void *ctx, time_t secondsEpoch, uint32_t channelMask, const timeseries::QueryValue *values, size_t channels)
+    {
+        TimeseriesPlugin *myself = static_cast<TimeseriesPlugin *>(ctx);
+        size_t rowPos = myself->valuesPos;
+        size_t rowCount = myself->valuesCount;
+        for (size_t c = 0; c < channels; c++)
+        {
+            if (!(channelMask & (1u << c)))
+                continue;
+            WsProtocol::timeseries::TimeseriesValue::Payload item{};
+            item.secondsEpoch = secondsEpoch;
+            item.channel = (uint8_t)c;
+            item.mean = values[c].mean;
+            item.min = values[c].min;
+            item.max = values[c].max;
+            item.last = values[c].last;
+            size_t newPos = WsProtocol::timeseries::AppendResponseTimeseriesValuesTimeseriesValueElement(item, myself->valuesScratch, myself->valuesPos, sizeof(myself->valuesScratch));
+            if (newPos == 0)
+            {
+                myself->valuesPos = rowPos;
+                myself->valuesCount = rowCount;
+                myself->nextFromEpoch = secondsEpoch;
+                return false;
+            }
+            myself->valuesPos = newPos;
+            myself->valuesCount++;
+        }
+        return true;
+    }
+
+    webmanager::eMessageReceiverResult sendResponseTimeseries(webmanager::iWebmanagerCallback *callback, const WsProtocol::timeseries::RequestTimeseries::Payload &req)
+    {
+        if (req.granularity >= (uint8_t)timeseries::Granularity::MAX)
+        {
+            ESP_LOGW(TAG, "Invalid granularity %u", (unsigned)req.granularity);
+            return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+        }
+        timeseries::Granularity g = (timeseries::Granularity)req.granularity;
+        valuesPos = 0;
+        valuesCount = 0;
+        nextFromEpoch = -1;
+        if (store->Query(g, req.fromEpoch, req.toEpoch, req.channelMask, appendRow, this) != ErrorCode::OK)
+            return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+
+        timeseries::RecordFormat format = store->GetRecordFormat(g);
+        WsProtocol::timeseries::ResponseTimeseries::Payload resp{};
+        resp.requestId = req.requestId;
+        resp.granularity = req.granularity;
+        resp.recordLayout = (uint8_t)format.layout;
+        resp.channels = format.channels;
+        resp.sampleType = (uint8_t)format.sampleType;
+        resp.complete = nextFromEpoch == -1;
+        resp.nextFromEpoch = nextFromEpoch;
+        resp.valuesData = valuesScratch;
+        resp.valuesCount = valuesCount;
+        resp.valuesDataSize = valuesPos;
+
+        webmanager::PooledFrame *f = callback->ReserveFrame(VALUES_SCRATCH_SIZE + 64);
+        if (!f)
+            return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+        size_t len = WsProtocol::timeseries::ResponseTimeseries::Encode(resp, f->buffer, f->capacity);
+        return callback->CommitFrame(f, len) == ESP_OK ? webmanager::eMessageReceiverResult::OK : webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+    }
+
+public:
+    TimeseriesPlugin(timeseries::iTimeseries *store) : store(store)
+    {
+    }
+
+    void OnBegin(webmanager::iWebmanagerCallback *callback) override { (void)(callback); }
+    void OnWifiConnect(webmanager::iWebmanagerCallback *callback) override { (void)(callback); }
+    void OnWifiDisconnect(webmanager::iWebmanagerCallback *callback) override { (void)(callback); }
+    void OnTimeUpdate(webmanager::iWebmanagerCallback *callback) override { (void)(callback); }
+    uint16_t GetNamespaceId() override { return WsProtocol::timeseries::NAMESPACE_ID; }
+    webmanager::eMessageReceiverResult ProvideWebsocketMessage(webmanager::iWebmanagerCallback *callback, httpd_req_t *req, httpd_ws_frame_t *ws_pkt, uint16_t namespaceId, uint16_t messageTypeId, const uint8_t *frame, size_t frameLen) override
+    {
+        if (namespaceId != WsProtocol::timeseries::NAMESPACE_ID)
+            return webmanager::eMessageReceiverResult::NOT_FOR_ME;
+
+        switch (messageTypeId)
+        {
+        case WsProtocol::timeseries::RequestTimeseries::TYPE_ID:
+        {
+            WsProtocol::timeseries::RequestTimeseries::Payload request{};
+            if (!WsProtocol::timeseries::RequestTimeseries::Decode(frame, frameLen, request))
+                return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            return sendResponseTimeseries(callback, request);
+        }
+        default:
+            return webmanager::eMessageReceiverResult::FOR_ME_BUT_FAILED;
+        }
+    }
+};
+#undef TAG
@@ -0,0 +1,276 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_http_server.h>
+#include <esp_timer.h>
+#include "webmanager_constants.hh"
+#include "webmanager_interfaces.hh"
+#include "webmanager_sessions.hh"
+#include "webmanager_dispatch.hh"
+
+#define TAG "WSRX"
+
+namespace webmanager
+{
+    // Empfangspfad fuer eingehende Websocket-Frames. Vorher wurde je Frame new uint8_t[ws_pkt.len] ohne
+    // jede Obergrenze allokiert -- ein einzelner grosser Frame konnte den Heap leeren. Jetzt:
+    //  - ein einmalig allokierter Empfangspuffer (WS_RX_ARENA_SIZE); groessere Frames werden abgewiesen
+    //    (Rueckgabe != ESP_OK, der httpd schliesst daraufhin die Verbindung, weil der Rest des Frames
+    //    ungelesen im Socket steht).
+    //  - Nachrichten, die der Client fragmentiert (erster Frame BINARY mit final=false, dann CONTINUE-Frames),
+    //    werden im Puffer zusammengesetzt -- oder, falls fuer (namespaceId, messageTypeId) ein Streaming-Handler
+    //    registriert ist, Fragment fuer Fragment an diesen durchgereicht, ohne je die ganze Nachricht zu puffern.
+    //    httpd_ws_recv_frame kann einen Frame nicht stueckweise lesen, deshalb ist das Fragment (und nicht ein
+    //    beliebig kleiner Teil eines Frames) die Einheit des Streamings.
+    // Alle Aufrufe kommen aus dem httpd-Task, also strikt nacheinander -- kein Lock noetig. Es kann immer nur
+    // eine fragmentierte Nachricht gleichzeitig in Arbeit sein (Browser fragmentieren von sich aus nie, das
+    // betrifft nur eigene Clients); vollstaendige Frames anderer Sessions werden waehrenddessen hinter den
+    // bereits zusammengesetzten Teil gelesen und ganz normal verteilt.
+    class WsReceiver
+    {
+    private:
+        enum class eMode
+        {
+            IDLE,
+            REASSEMBLE, // Fragmente werden in 'arena' hintereinander gesetzt
+            STREAM,     // jedes Fragment geht sofort an streamFn, 'arena' haelt nur das aktuelle Fragment
+            DISCARD,    // Nachricht abgebrochen (zu gross, Handler fehlgeschlagen), Rest wird gelesen und verworfen
+        };
+
+        WsDispatchTable *dispatch;
+        uint8_t *arena{nullptr};
+        eMode mode{eMode::IDLE};
+        int ownerFd{-1};
+        size_t assembled{0}; // REASSEMBLE: belegte Bytes in 'arena'; STREAM: bereits durchgereichte Bytes
+        uint16_t namespaceId{0};
+        uint16_t messageTypeId{0};
+        StreamHandlerFn streamFn{nullptr};
+        void *streamCtx{nullptr};
+        WsReceiveStats stats{};
+
+        void reset()
+        {
+            mode = eMode::IDLE;
+            ownerFd = -1;
+            assembled = 0;
+            streamFn = nullptr;
+            streamCtx = nullptr;
+        }
+
+        // Platz hinter einer gerade zusammengesetzten Nachricht; der gesamte Puffer, wenn keine in Arbeit ist
+        size_t freeOffset() const
+        {
+            return mode == eMode::REASSEMBLE ? assembled : 0;
+        }
+
+        void countDispatch(int64_t start_us)
+        {
+            uint32_t duration_us = (uint32_t)(esp_timer_get_time() - start_us);
+            stats.dispatched++;
+            stats.dispatchTimeTotalUs += duration_us;
+            stats.dispatchTimeMaxUs = std::max(stats.dispatchTimeMaxUs, duration_us);
+        }
+
+        void logResult(eMessageReceiverResult res, uint16_t ns)
+        {
+            if (res == eMessageReceiverResult::NOT_FOR_ME)
+            {
+                ESP_LOGW(TAG, "Not yet implemented request for namespace %u, neither internal nor in a plugin", (unsigned)ns);
+            }
+            else if (res == eMessageReceiverResult::FOR_ME_BUT_FAILED)
+            {
+                ESP_LOGW(TAG, "Request for namespace %u has been implemented by plugin, but processing failed", (unsigned)ns);
+            }
+        }
+
+        void dispatchWhole(WsSession *session, httpd_req_t *req, httpd_ws_frame_t *ws_pkt, const uint8_t *frame, size_t frameLen)
+        {
+            if (frameLen < 4)
+            {
+                ESP_LOGW(TAG, "Ignoring short websocket binary frame (len=%u)", (unsigned)frameLen);
+                return;
+            }
+            if (!session)
+            {
+                ESP_LOGW(TAG, "Ignoring websocket frame, no session available for fd %d", (int)httpd_req_to_sockfd(req));
+                return;
+            }
+            uint16_t ns = (uint16_t)(frame[0] | (frame[1] << 8));
+            uint16_t type = (uint16_t)(frame[2] | (frame[3] << 8));
+            int64_t start_us = esp_timer_get_time();
+            eMessageReceiverResult res = dispatch->Dispatch(session, req, ws_pkt, ns, type, frame, frameLen);
+            countDispatch(start_us);
+            logResult(res, ns);
+        }
+
+        void streamChunk(WsSession *session, const uint8_t *chunk, size_t chunkLen, bool last)
+        {
+            int64_t start_us = esp_timer_get_time();
+            eMessageReceiverResult res = session ? streamFn(streamCtx, session, chunk, chunkLen, assembled, last) : eMessageReceiverResult::FOR_ME_BUT_FAILED;
+            countDispatch(start_us);
+            assembled += chunkLen;
+            if (res != eMessageReceiverResult::OK)
+            {
+                logResult(res, namespaceId);
+                mode = last ? eMode::IDLE : eMode::DISCARD;
+            }
+            if (last)
+                reset();
+        }
+
+    public:
+        WsReceiver(WsDispatchTable *dispatch) : dispatch(dispatch)
+        {
+            arena = new uint8_t[WS_RX_ARENA_SIZE];
+        }
+
+        // Nur aus dem httpd-Task geschrieben; ein Leser in einem anderen Task sieht schlimmstenfalls einen
+        // halb aktualisierten Zaehlerstand, das ist fuer die Diagnose unerheblich.
+        WsReceiveStats GetStats() const { return stats; }
+
+        // Aufruf, wenn der Socket 'fd' geschlossen wurde (M::HttpdCloseFn bzw. neuer Handshake auf einem
+        // wiederverwendeten fd). War dort eine fragmentierte Nachricht in Arbeit, wird sie verworfen -- sonst
+        // blieben 'mode'/'ownerFd' fuer immer belegt, fragmentierte Nachrichten aller anderen Clients wuerden
+        // abgewiesen und ganze Frames nur noch hinter den verwaisten Teil in den Puffer gelesen.
+        void OnSocketClosed(int fd)
+        {
+            if (mode == eMode::IDLE || fd != ownerFd)
+                return;
+            ESP_LOGW(TAG, "fd %d closed in the middle of a fragmented message, dropping %u bytes", fd, (unsigned)assembled);
+            reset();
+        }
+
+        // Liest den naechsten Frame aus 'req' und verteilt ihn; 'session' darf nullptr sein (Frame wird dann
+        // gelesen, aber verworfen).
+        esp_err_t Receive(httpd_req_t *req, WsSession *session)
+        {
+            int fd = httpd_req_to_sockfd(req);
+            httpd_ws_frame_t ws_pkt = {false, false, HTTPD_WS_TYPE_BINARY, nullptr, 0};
+            /* Set max_len = 0 to get the frame len */
+            esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
+            if (ret != ESP_OK)
+            {
+                // Bad/malformed websocket frames can happen during disconnect/AP transitions.
+                // Never abort the device from this callback.
+                if (ret == ESP_ERR_INVALID_STATE)
+                {
+                    ESP_LOGW(TAG, "Ignoring websocket frame in invalid state (%d)", ret);
+                    return ESP_OK;
+                }
+                ESP_LOGW(TAG, "httpd_ws_recv_frame(header) failed with %d", ret);
+                return ret;
+            }
+            bool continuation = ws_pkt.type == HTTPD_WS_TYPE_CONTINUE;
+            if (!continuation && (ws_pkt.len == 0 || ws_pkt.type != HTTPD_WS_TYPE_BINARY))
+            {
+                ESP_LOGE(TAG, "Received an empty or an non binary websocket frame");
+                return ESP_OK;
+            }
+            if (continuation && (mode == eMode::IDLE || fd != ownerFd))
+            {
+                ESP_LOGW(TAG, "Continuation frame without a started message from fd %d", fd);
+                return ESP_ERR_INVALID_STATE;
+            }
+            if (mode != eMode::IDLE && fd != ownerFd && httpd_ws_get_fd_info(req->handle, ownerFd) != HTTPD_WS_CLIENT_WEBSOCKET)
+            {
+                // Absender der angefangenen Nachricht ist weg, ohne dass OnSocketClosed aufgerufen wurde
+                OnSocketClosed(ownerFd);
+            }
+            if (!continuation && mode != eMode::IDLE)
+            {
+                if (fd == ownerFd)
+                {
+                    ESP_LOGW(TAG, "fd %d started a new message before finishing the fragmented one, dropping %u bytes", fd, (unsigned)assembled);
+                    reset();
+                }
+                else if (!ws_pkt.final)
+                {
+                    ESP_LOGW(TAG, "fd %d started a fragmented message while fd %d is still sending one", fd, ownerFd);
+                    return ESP_ERR_INVALID_STATE;
+                }
+            }
+
+            size_t offset = freeOffset();
+            if (continuation && mode == eMode::REASSEMBLE && ws_pkt.len > WS_RX_ARENA_SIZE - offset && ws_pkt.len <= WS_RX_ARENA_SIZE)
+            {
+                // das Fragment selbst passt, die zusammengesetzte Nachricht nicht mehr -- Rest lesen und verwerfen
+                stats.oversizeFrames++;
+                ESP_LOGW(TAG, "Fragmented message from fd %d exceeds the receive buffer of %u bytes, discarding", fd, (unsigned)WS_RX_ARENA_SIZE);
+                mode = eMode::DISCARD;
+                offset = 0;
+            }
+            if (ws_pkt.len > WS_RX_ARENA_SIZE - offset)
+            {
+                stats.oversizeFrames++;
+                ESP_LOGW(TAG, "Websocket frame of %u bytes from fd %d exceeds the receive buffer (%u bytes free), closing", (unsigned)ws_pkt.len, fd, (unsigned)(WS_RX_ARENA_SIZE - offset));
+                if (fd == ownerFd)
+                    reset();
+                return ESP_ERR_INVALID_SIZE;
+            }
+            ws_pkt.payload = arena + offset;
+            ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
+            if (ret != ESP_OK)
+            {
+                ESP_LOGE(TAG, "httpd_ws_recv_frame failed with %d", ret);
+                if (fd == ownerFd)
+                    reset();
+                return ret;
+            }
+            stats.frames++;
+            stats.bytes += ws_pkt.len;
+
+            if (!continuation && ws_pkt.final)
+            {
+                dispatchWhole(session, req, &ws_pkt, ws_pkt.payload, ws_pkt.len);
+                return ESP_OK;
+            }
+
+            if (!continuation)
+            {
+                // erstes Fragment einer fragmentierten Nachricht
+                ownerFd = fd;
+                assembled = 0;
+                if (ws_pkt.len >= 4)
+                {
+                    namespaceId = (uint16_t)(ws_pkt.payload[0] | (ws_pkt.payload[1] << 8));
+                    messageTypeId = (uint16_t)(ws_pkt.payload[2] | (ws_pkt.payload[3] << 8));
+                    if (dispatch->FindStreamHandler(namespaceId, messageTypeId, streamFn, streamCtx))
+                    {
+                        mode = eMode::STREAM;
+                        streamChunk(session, ws_pkt.payload, ws_pkt.len, false);
+                        return ESP_OK;
+                    }
+                }
+                mode = eMode::REASSEMBLE;
+                assembled = ws_pkt.len;
+                return ESP_OK;
+            }
+
+            switch (mode)
+            {
+            case eMode::STREAM:
+                streamChunk(session, ws_pkt.payload, ws_pkt.len, ws_pkt.final);
+                break;
+            case eMode::REASSEMBLE:
+                assembled += ws_pkt.len;
+                if (ws_pkt.final)
+                {
+                    ws_pkt.payload = arena;
+                    ws_pkt.len = assembled;
+                    reset();
+                    dispatchWhole(session, req, &ws_pkt, ws_pkt.payload, ws_pkt.len);
+                }
+                break;
+            default: // DISCARD
+                if (ws_pkt.final)
+                    reset();
+                break;
+            }
+            return ESP_OK;
+        }
+    };
+}
+#undef TAG
@@ -0,0 +1,542 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_http_server.h>
+#include <esp_timer.h>
+#include "webmanager_constants.hh"
+#include "webmanager_interfaces.hh"
+#include "webmanager_frame_pool.hh"
+
+#define TAG "WSSESS"
+
+namespace webmanager
+{
+    class WsSessionTable;
+
+    // Eine geoeffnete Websocket-Verbindung (ein Browser-Tab). Implementiert selbst iWebmanagerCallback --
+    // der Dispatcher reicht die Session als 'callback' an ProvideWebsocketMessage durch, damit Antworten
+    // eines Plugins (callback->SendRawAsync) automatisch NUR an den anfragenden Tab gehen (Unicast),
+    // waehrend Server-Pushes ueber den in OnBegin erhaltenen M-Callback an alle Tabs gehen (Broadcast).
+    // Die Session-Objekte liegen fest in WsSessionTable::sessions, ein gespeicherter Zeiger bleibt also
+    // gueltig; nach dem Schliessen des Tabs (M::HttpdCloseFn bzw. spaetestens beim naechsten Senden erkannt)
+    // liefert SendRawAsync ESP_ERR_INVALID_STATE.
+    class WsSession : public iWebmanagerCallback
+    {
+        friend class WsSessionTable;
+
+    private:
+        WsSessionTable *table{nullptr};
+        int fd{-1};
+        uint32_t id{0};
+        std::array<PooledFrame *, WS_SESSION_QUEUE_LEN> ring{};
+        size_t head{0};
+        size_t count{0};
+        bool drainScheduled{false};
+        uint8_t consecutiveSendErrors{0};
+
+    public:
+        int GetFd() const { return fd; }
+        uint32_t GetSessionId() override { return id; }
+        esp_err_t SendRawAsync(const uint8_t *data, size_t len) override;
+        PooledFrame *ReserveFrame(size_t maxLen) override;
+        esp_err_t CommitFrame(PooledFrame *frame, size_t len) override;
+        FramePoolStats GetFramePoolStats() override;
+        void SetSendPolicy(uint16_t namespaceId, uint16_t messageTypeId, eSendPolicy policy) override;
+        WsSendStats GetWebsocketSendStats() override;
+        WsReceiveStats GetWebsocketReceiveStats() override;
+        esp_err_t RegisterMessageHandler(uint16_t namespaceId, uint16_t messageTypeId, MessageHandlerFn handler, void *ctx) override;
+        esp_err_t RegisterStreamHandler(uint16_t namespaceId, uint16_t messageTypeId, StreamHandlerFn handler, void *ctx) override;
+    };
+
+    // Begrenzte Tabelle (WS_MAX_SESSIONS) aller offenen Websocket-Sessions mit je einem Ring
+    // (WS_SESSION_QUEUE_LEN) ausstehender Frames. Ein Broadcast legt denselben PooledFrame in alle Ringe
+    // und zaehlt PooledFrame::refCount hoch -- keine Kopie je Client; der letzte Sender gibt den Frame an
+    // den Pool zurueck. Gesendet wird ausschliesslich im httpd-Task (drainWork via httpd_queue_work),
+    // je Session ist hoechstens ein drainWork gleichzeitig eingereiht.
+    // Gegendruck: der Ring ist die harte Obergrenze je Client. Was bei vollem Ring passiert, bestimmt die
+    // eSendPolicy des Nachrichtentyps (Policy-Tabelle, Standard MUST_DELIVER).
+    class WsSessionTable
+    {
+        friend class WsSession;
+
+    private:
+        struct PolicyEntry
+        {
+            uint16_t namespaceId;
+            uint16_t messageTypeId;
+            eSendPolicy policy;
+        };
+
+        FramePool *pool;
+        iWebmanagerCallback *owner; // der Webmanager selbst, beantwortet serverweite Abfragen (Empfangsstatistik)
+        httpd_handle_t server{nullptr};
+        std::array<WsSession, WS_MAX_SESSIONS> sessions;
+        std::array<PolicyEntry, WS_MAX_SEND_POLICIES> policies{};
+        size_t policyCount{0};
+        WsSendStats sendStats{};
+        uint32_t lastSessionId{0};
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+        static uint16_t namespaceOf(const PooledFrame *f) { return (uint16_t)(f->buffer[0] | (f->buffer[1] << 8)); }
+        static uint16_t messageTypeOf(const PooledFrame *f) { return (uint16_t)(f->buffer[2] | (f->buffer[3] << 8)); }
+
+        eSendPolicy lookupPolicy(const PooledFrame *f)
+        {
+            if (f->len < 4)
+                return eSendPolicy::MUST_DELIVER;
+            uint16_t ns = namespaceOf(f);
+            uint16_t type = messageTypeOf(f);
+            eSendPolicy policy{eSendPolicy::MUST_DELIVER};
+            portENTER_CRITICAL(&lock);
+            for (size_t i = 0; i < policyCount; i++)
+            {
+                if (policies[i].namespaceId == ns && policies[i].messageTypeId == type)
+                {
+                    policy = policies[i].policy;
+                    break;
+                }
+            }
+            portEXIT_CRITICAL(&lock);
+            return policy;
+        }
+
+        // nur unter 'lock' aufrufen. Entfernt den Ring-Eintrag an Position 'pos' (relativ zu head) und
+        // liefert den Frame, falls dessen letzte Referenz damit weggefallen ist (-> ausserhalb des Locks freigeben).
+        PooledFrame *removeAtLocked(WsSession *s, size_t pos)
+        {
+            PooledFrame *victim = s->ring[(s->head + pos) % WS_SESSION_QUEUE_LEN];
+            for (size_t j = pos; j + 1 < s->count; j++)
+                s->ring[(s->head + j) % WS_SESSION_QUEUE_LEN] = s->ring[(s->head + j + 1) % WS_SESSION_QUEUE_LEN];
+            s->count--;
+            return --victim->refCount == 0 ? victim : nullptr;
+        }
+
+        // nur unter 'lock' aufrufen. Wendet die Policy von 'f' an; 'toRelease' bekommt ggf. einen
+        // verdraengten Frame, der ausserhalb des Locks an den Pool zurueck muss.
+        bool enqueueLocked(WsSession *s, PooledFrame *f, PooledFrame *&toRelease)
+        {
+            toRelease = nullptr;
+            if (s->fd == -1)
+                return false;
+            if (f->policy == eSendPolicy::COALESCE_LATEST)
+            {
+                for (size_t i = 0; i < s->count; i++)
+                {
+                    size_t idx = (s->head + i) % WS_SESSION_QUEUE_LEN;
+                    PooledFrame *old = s->ring[idx];
+                    if (old->policy == eSendPolicy::COALESCE_LATEST && old->coalesceKey == f->coalesceKey && namespaceOf(old) == namespaceOf(f) && messageTypeOf(old) == messageTypeOf(f))
+                    {
+                        s->ring[idx] = f;
+                        f->refCount++;
+                        if (--old->refCount == 0)
+                            toRelease = old;
+                        sendStats.coalesced++;
+                        return true;
+                    }
+                }
+            }
+            if (s->count == WS_SESSION_QUEUE_LEN)
+            {
+                size_t victimPos{0};
+                while (victimPos < s->count && s->ring[(s->head + victimPos) % WS_SESSION_QUEUE_LEN]->policy == eSendPolicy::MUST_DELIVER)
+                    victimPos++;
+                if (victimPos == s->count)
+                {
+                    // nur noch MUST_DELIVER-Frames im Ring -- der neue Frame hat keinen Platz
+                    sendStats.dropped[(size_t)f->policy]++;
+                    return false;
+                }
+                sendStats.dropped[(size_t)s->ring[(s->head + victimPos) % WS_SESSION_QUEUE_LEN]->policy]++;
+                toRelease = removeAtLocked(s, victimPos);
+            }
+            s->ring[(s->head + s->count) % WS_SESSION_QUEUE_LEN] = f;
+            s->count++;
+            f->refCount++;
+            sendStats.queueHighWater = std::max(sendStats.queueHighWater, (uint16_t)s->count);
+            return true;
+        }
+
+        // nur unter 'lock' aufrufen; true, wenn der Aufrufer (ausserhalb des Locks) einen drainWork einreihen muss
+        bool claimDrainLocked(WsSession *s)
+        {
+            if (s->drainScheduled)
+                return false;
+            s->drainScheduled = true;
+            return true;
+        }
+
+        void unref(PooledFrame *f)
+        {
+            portENTER_CRITICAL(&lock);
+            bool last = --f->refCount == 0;
+            portEXIT_CRITICAL(&lock);
+            if (last)
+                pool->Release(f);
+        }
+
+        void scheduleDrain(WsSession *s)
+        {
+            if (httpd_queue_work(server, WsSessionTable::drainWork, s) == ESP_OK)
+                return;
+            // Frames bleiben im Ring liegen, der naechste Enqueue versucht es erneut
+            ESP_LOGW(TAG, "httpd_queue_work failed for websocket session fd %d", s->fd);
+            portENTER_CRITICAL(&lock);
+            s->drainScheduled = false;
+            portEXIT_CRITICAL(&lock);
+        }
+
+        static void drainWork(void *arg)
+        {
+            WsSession *s = static_cast<WsSession *>(arg);
+            WsSessionTable *t = s->table;
+            while (true)
+            {
+                portENTER_CRITICAL(&t->lock);
+                if (s->count == 0)
+                {
+                    s->drainScheduled = false;
+                    portEXIT_CRITICAL(&t->lock);
+                    return;
+                }
+                PooledFrame *f = s->ring[s->head];
+                s->head = (s->head + 1) % WS_SESSION_QUEUE_LEN;
+                s->count--;
+                int fd = s->fd;
+                portEXIT_CRITICAL(&t->lock);
+
+                if (httpd_ws_get_fd_info(t->server, fd) != HTTPD_WS_CLIENT_WEBSOCKET)
+                {
+                    // Tab geschlossen, ohne dass M::HttpdCloseFn es gemeldet hat (oder fd inzwischen ein
+                    // HTTP-Socket) -- nichts mehr an diesen fd senden
+                    ESP_LOGI(TAG, "fd %d is no longer a websocket, dropping its session", fd);
+                    t->unref(f);
+                    t->Unregister(fd);
+                    continue;
+                }
+                httpd_ws_frame_t ws_pkt = {false, false, HTTPD_WS_TYPE_BINARY, f->buffer, f->len};
+                int64_t start_us = esp_timer_get_time();
+                esp_err_t ret = httpd_ws_send_frame_async(t->server, fd, &ws_pkt);
+                uint32_t duration_us = (uint32_t)(esp_timer_get_time() - start_us);
+                size_t len = f->len;
+                t->unref(f);
+                portENTER_CRITICAL(&t->lock);
+                bool giveUp{false};
+                t->sendStats.sendTimeTotalUs += duration_us;
+                t->sendStats.sendTimeMaxUs = std::max(t->sendStats.sendTimeMaxUs, duration_us);
+                if (ret == ESP_OK)
+                {
+                    s->consecutiveSendErrors = 0;
+                    t->sendStats.sentFrames++;
+                    t->sendStats.sentBytes += len;
+                }
+                else
+                {
+                    t->sendStats.sendErrors++;
+                    giveUp = ++s->consecutiveSendErrors >= WS_MAX_CONSECUTIVE_SEND_ERRORS;
+                }
+                portEXIT_CRITICAL(&t->lock);
+                if (ret != ESP_OK)
+                {
+                    ESP_LOGW(TAG, "httpd_ws_send_frame_async failed (0x%x) for websocket session fd %d", (unsigned int)ret, fd);
+                }
+                if (giveUp)
+                {
+                    ESP_LOGW(TAG, "%d consecutive send errors. Invalidating websocket session fd %d", (int)WS_MAX_CONSECUTIVE_SEND_ERRORS, fd);
+                    httpd_sess_trigger_close(t->server, fd);
+                    t->Unregister(fd);
+                }
+            }
+        }
+
+    public:
+        WsSessionTable(FramePool *pool, iWebmanagerCallback *owner = nullptr) : pool(pool), owner(owner)
+        {
+            for (auto &s : sessions)
+                s.table = this;
+        }
+
+        void SetServer(httpd_handle_t server)
+        {
+            this->server = server;
+        }
+
+        WsSession *Find(int fd)
+        {
+            WsSession *found{nullptr};
+            portENTER_CRITICAL(&lock);
+            for (auto &s : sessions)
+            {
+                if (s.fd == fd)
+                {
+                    found = &s;
+                    break;
+                }
+            }
+            portEXIT_CRITICAL(&lock);
+            return found;
+        }
+
+        // Liefert die Session zu 'fd' (legt sie bei Bedarf an). Ist die Tabelle voll, werden zunaechst
+        // Sessions entfernt, deren Socket laengst kein Websocket mehr ist (Tab geschlossen, ohne dass ein
+        // Sendefehler das bemerkt haette). nullptr, wenn danach immer noch kein Platz ist.
+        WsSession *Register(int fd)
+        {
+            WsSession *s = Find(fd);
+            if (s)
+                return s;
+            for (int attempt = 0; attempt < 2; attempt++)
+            {
+                portENTER_CRITICAL(&lock);
+                for (auto &candidate : sessions)
+                {
+                    if (candidate.fd == -1)
+                    {
+                        candidate.fd = fd;
+                        candidate.id = ++lastSessionId == 0 ? ++lastSessionId : lastSessionId;
+                        candidate.head = 0;
+                        candidate.count = 0;
+                        candidate.consecutiveSendErrors = 0;
+                        portEXIT_CRITICAL(&lock);
+                        ESP_LOGI(TAG, "Registered websocket session fd %d", fd);
+                        return &candidate;
+                    }
+                }
+                portEXIT_CRITICAL(&lock);
+                if (attempt == 0)
+                {
+                    for (auto &candidate : sessions)
+                    {
+                        int candidateFd = candidate.fd;
+                        if (candidateFd != -1 && httpd_ws_get_fd_info(server, candidateFd) != HTTPD_WS_CLIENT_WEBSOCKET)
+                            Unregister(candidateFd);
+                    }
+                }
+            }
+            ESP_LOGW(TAG, "Websocket session table full (%d sessions), rejecting fd %d", (int)WS_MAX_SESSIONS, fd);
+            return nullptr;
+        }
+
+        void Unregister(int fd)
+        {
+            std::array<PooledFrame *, WS_SESSION_QUEUE_LEN> orphans{};
+            size_t orphanCount{0};
+            portENTER_CRITICAL(&lock);
+            for (auto &s : sessions)
+            {
+                if (s.fd != fd)
+                    continue;
+                while (s.count > 0)
+                {
+                    orphans[orphanCount++] = s.ring[s.head];
+                    s.head = (s.head + 1) % WS_SESSION_QUEUE_LEN;
+                    s.count--;
+                }
+                s.fd = -1; // drainScheduled bleibt ggf. gesetzt, der eingereihte drainWork raeumt es ab
+            }
+            portEXIT_CRITICAL(&lock);
+            for (size_t i = 0; i < orphanCount; i++)
+                unref(orphans[i]);
+            if (orphanCount)
+                ESP_LOGD(TAG, "Dropped %d pending frames of websocket session fd %d", (int)orphanCount, fd);
+        }
+
+        size_t Count()
+        {
+            size_t n{0};
+            portENTER_CRITICAL(&lock);
+            for (auto &s : sessions)
+                if (s.fd != -1)
+                    n++;
+            portEXIT_CRITICAL(&lock);
+            return n;
+        }
+
+        // Legt die Sendestrategie fuer einen Nachrichtentyp fest; ein erneuter Aufruf ueberschreibt den Eintrag.
+        void SetSendPolicy(uint16_t namespaceId, uint16_t messageTypeId, eSendPolicy policy)
+        {
+            portENTER_CRITICAL(&lock);
+            size_t i{0};
+            while (i < policyCount && !(policies[i].namespaceId == namespaceId && policies[i].messageTypeId == messageTypeId))
+                i++;
+            bool full = i == WS_MAX_SEND_POLICIES;
+            if (!full)
+            {
+                policies[i] = {namespaceId, messageTypeId, policy};
+                policyCount = std::max(policyCount, i + 1);
+            }
+            portEXIT_CRITICAL(&lock);
+            if (full)
+                ESP_LOGE(TAG, "Send policy table full (%d entries), ignoring policy for %d/%d", (int)WS_MAX_SEND_POLICIES, namespaceId, messageTypeId);
+        }
+
+        WsSendStats GetSendStats()
+        {
+            portENTER_CRITICAL(&lock);
+            WsSendStats copy = sendStats;
+            copy.activeSessions = 0;
+            for (auto &s : sessions)
+                if (s.fd != -1)
+                    copy.activeSessions++;
+            portEXIT_CRITICAL(&lock);
+            return copy;
+        }
+
+        // Uebernimmt 'f' in jedem Fall.
+        esp_err_t Unicast(WsSession *s, PooledFrame *f)
+        {
+            f->policy = lookupPolicy(f);
+            PooledFrame *evicted{nullptr};
+            portENTER_CRITICAL(&lock);
+            if (s->fd == -1)
+            {
+                portEXIT_CRITICAL(&lock);
+                pool->Release(f);
+                return ESP_ERR_INVALID_STATE;
+            }
+            bool queued = enqueueLocked(s, f, evicted);
+            bool mustDrain = queued && claimDrainLocked(s);
+            portEXIT_CRITICAL(&lock);
+            if (evicted)
+                pool->Release(evicted);
+            if (!queued)
+            {
+                ESP_LOGW(TAG, "Send queue of websocket session fd %d full, dropping %d bytes", s->fd, (int)f->len);
+                pool->Release(f);
+                return ESP_ERR_NO_MEM;
+            }
+            if (mustDrain)
+                scheduleDrain(s);
+            return ESP_OK;
+        }
+
+        // Uebernimmt 'f' in jedem Fall. ESP_OK, sobald mindestens eine Session den Frame eingereiht hat.
+        esp_err_t Broadcast(PooledFrame *f)
+        {
+            std::array<WsSession *, WS_MAX_SESSIONS> toDrain{};
+            std::array<PooledFrame *, WS_MAX_SESSIONS> evicted{};
+            size_t drainCount{0};
+            size_t sessionCount{0};
+            f->policy = lookupPolicy(f);
+            portENTER_CRITICAL(&lock);
+            f->refCount++; // Schutz-Referenz, damit ein parallel laufender drainWork den Frame nicht vorzeitig freigibt
+            for (auto &s : sessions)
+            {
+                if (s.fd == -1)
+                    continue;
+                if (enqueueLocked(&s, f, evicted[sessionCount]) && claimDrainLocked(&s))
+                    toDrain[drainCount++] = &s;
+                sessionCount++;
+            }
+            bool queuedSomewhere = f->refCount > 1;
+            portEXIT_CRITICAL(&lock);
+            for (auto *e : evicted)
+                if (e)
+                    pool->Release(e);
+            for (size_t i = 0; i < drainCount; i++)
+                scheduleDrain(toDrain[i]);
+            unref(f);
+            if (sessionCount == 0)
+                return ESP_ERR_INVALID_STATE;
+            return queuedSomewhere ? ESP_OK : ESP_ERR_NO_MEM;
+        }
+
+        // Schliesst alle Sessions mit einem regulaeren Close-Frame (1000 = normal closure).
+        void CloseAll()
+        {
+            for (auto &s : sessions)
+            {
+                int fd = s.fd;
+                if (fd == -1)
+                    continue;
+                if (httpd_ws_get_fd_info(server, fd) == HTTPD_WS_CLIENT_WEBSOCKET)
+                {
+                    uint8_t close_payload[2] = {0x03, 0xE8};
+                    httpd_ws_frame_t close_pkt = {false, false, HTTPD_WS_TYPE_CLOSE, close_payload, sizeof(close_payload)};
+                    esp_err_t send_ret = httpd_ws_send_frame_async(server, fd, &close_pkt);
+                    if (send_ret != ESP_OK)
+                    {
+                        ESP_LOGW(TAG, "Failed to send websocket close frame to fd %d (%d)", fd, send_ret);
+                    }
+                }
+                httpd_sess_trigger_close(server, fd);
+                Unregister(fd);
+                ESP_LOGI(TAG, "Closed websocket session fd %d", fd);
+            }
+        }
+    };
+
+    inline esp_err_t WsSession::SendRawAsync(const uint8_t *data, size_t len)
+    {
+        if (fd == -1)
+            return ESP_ERR_INVALID_STATE;
+        PooledFrame *f = ReserveFrame(len);
+        if (!f)
+            return ESP_ERR_NO_MEM;
+        std::memcpy(f->buffer, data, len);
+        return CommitFrame(f, len);
+    }
+
+    inline PooledFrame *WsSession::ReserveFrame(size_t maxLen)
+    {
+        PooledFrame *f = table->pool->Reserve(maxLen);
+        if (!f)
+            ESP_LOGW(TAG, "ReserveFrame: frame pool exhausted for %d bytes", (int)maxLen);
+        return f;
+    }
+
+    inline esp_err_t WsSession::CommitFrame(PooledFrame *f, size_t len)
+    {
+        if (!f)
+            return ESP_ERR_INVALID_ARG;
+        if (len == 0 || len > f->capacity)
+        {
+            table->pool->Release(f);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        f->len = len;
+        return table->Unicast(this, f);
+    }
+
+    inline FramePoolStats WsSession::GetFramePoolStats()
+    {
+        return table->pool->GetStats();
+    }
+
+    inline void WsSession::SetSendPolicy(uint16_t namespaceId, uint16_t messageTypeId, eSendPolicy policy)
+    {
+        table->SetSendPolicy(namespaceId, messageTypeId, policy);
+    }
+
+    inline WsSendStats WsSession::GetWebsocketSendStats()
+    {
+        return table->GetSendStats();
+    }
+
+    inline WsReceiveStats WsSession::GetWebsocketReceiveStats()
+    {
+        return table->owner ? table->owner->GetWebsocketReceiveStats() : WsReceiveStats{};
+    }
+
+    inline esp_err_t WsSession::RegisterMessageHandler(uint16_t namespaceId, uint16_t messageTypeId, MessageHandlerFn handler, void *ctx)
+    {
+        (void)(handler);
+        (void)(ctx);
+        ESP_LOGE(TAG, "RegisterMessageHandler(%u/%u) must be called on the callback passed to OnBegin", namespaceId, messageTypeId);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    inline esp_err_t WsSession::RegisterStreamHandler(uint16_t namespaceId, uint16_t messageTypeId, StreamHandlerFn handler, void *ctx)
+    {
+        (void)(handler);
+        (void)(ctx);
+        ESP_LOGE(TAG, "RegisterStreamHandler(%u/%u) must be called on the callback passed to OnBegin", namespaceId, messageTypeId);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+}
+#undef TAG
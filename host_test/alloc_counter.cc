@@ -0,0 +1,43 @@
+// Zaehlt alle Heap-Allokationen des Prozesses fuer die allocs/op-Spalte von hostbench::Run
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace hostbench
+{
+    std::atomic<uint64_t> allocations{0};
+}
+
+void *operator new(std::size_t size)
+{
+    hostbench::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
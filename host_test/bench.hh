@@ -0,0 +1,71 @@
+#pragma once
+// Minimaler Benchmark-Rahmen im Stil von Google Benchmark, ohne externe Abhaengigkeit: Run() verdoppelt die
+// Iterationszahl, bis eine Messung mindestens die Zieldauer dauert, und meldet ns je Iteration sowie die
+// Heap-Allokationen je Iteration (gezaehlt ueber das globale operator new in alloc_counter.cc). Mit --quick
+// (so ruft ctest die Benchmarks auf) wird nur kurz gemessen; Expect-Fehler machen den Exit-Code ungleich 0.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace hostbench
+{
+    extern std::atomic<uint64_t> allocations;
+
+    inline bool quick{false};
+    inline int failures{0};
+
+    inline void ParseArgs(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; i++)
+            if (std::strcmp(argv[i], "--quick") == 0)
+                quick = true;
+    }
+
+    template <typename T>
+    inline void DoNotOptimize(T const &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    inline void Expect(bool condition, const char *what)
+    {
+        if (condition)
+            return;
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+
+    // 'fn(iterations)' fuehrt die zu messende Operation 'iterations' mal aus; liefert Allokationen je Iteration
+    template <typename FN>
+    double Run(const char *name, FN &&fn)
+    {
+        using clock = std::chrono::steady_clock;
+        const auto minDuration = quick ? std::chrono::milliseconds(5) : std::chrono::milliseconds(300);
+        uint64_t iterations{1};
+        while (true)
+        {
+            uint64_t allocsBefore = allocations.load(std::memory_order_relaxed);
+            auto start = clock::now();
+            fn(iterations);
+            auto elapsed = clock::now() - start;
+            uint64_t allocs = allocations.load(std::memory_order_relaxed) - allocsBefore;
+            if (elapsed >= minDuration || iterations >= (1ULL << 40))
+            {
+                double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+                double allocsPerOp = (double)allocs / iterations;
+                std::printf("%-48s %12llu %10.1f ns %8.2f allocs/op\n", name, (unsigned long long)iterations, ns / iterations, allocsPerOp);
+                return allocsPerOp;
+            }
+            iterations *= 2;
+        }
+    }
+
+    inline int Finish()
+    {
+        if (failures)
+            std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return failures ? 1 : 0;
+    }
+}
@@ -0,0 +1,68 @@
+// Benchmark Ephemeris: O(1)-Tabellenzugriff (Lookup) gegen die Berechnung von Sonnenauf- und -untergang je Tag
+// (sunsetsunrise::NextSunriseAndSunset<double>, so hat Scheduler::Loop frueher bei jedem Tageswechsel gerechnet),
+// dazu die einmaligen Kosten des Tabellenaufbaus. Auf dem Host rechnet eine FPU auch double -- auf dem ESP32 ist double
+// Software-Emulation, der Abstand dort also deutlich groesser.
+#include <cstdint>
+#include <ctime>
+#include "bench.hh"
+#include "scheduler_ephemeris.hh"
+
+using scheduler::Ephemeris;
+
+int main(int argc, char **argv)
+{
+    hostbench::ParseArgs(argc, argv);
+    host_log_level = ESP_LOG_ERROR;
+
+    const double latDeg = scheduler::DEFAULT_LATITUDE_MICRODEG / 1e6;
+    const double lonDeg = scheduler::DEFAULT_LONGITUDE_MICRODEG / 1e6;
+    const uint32_t firstDay = sunsetsunrise::JulianDate(1'700'000'000);
+
+    Ephemeris ephemeris;
+    ephemeris.Build(firstDay);
+
+    // jeder Tag der Tabelle muss genau das liefern, was die Berechnung fuer diesen Tag liefert
+    uint32_t mismatches{0};
+    for (uint32_t d = 0; d < scheduler::EPHEMERIS_DAYS; d++)
+    {
+        time_t sunrise, sunset, expectedSunrise, expectedSunset;
+        ephemeris.Lookup(firstDay + d, sunrise, sunset);
+        sunsetsunrise::NextSunriseAndSunset<double>(firstDay + d, latDeg, lonDeg, sunsetsunrise::eDawn::CIVIL, expectedSunrise, expectedSunset);
+        mismatches += sunrise != expectedSunrise || sunset != expectedSunset;
+    }
+    hostbench::Expect(mismatches == 0, "Lookup returns the computed sunrise and sunset for every day of the table");
+
+    // die Tage laufen innerhalb der Tabelle reihum, Lookup baut also nie neu auf
+    uint32_t day{0};
+    hostbench::Run("ephemeris/NextSunriseAndSunset_double", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            time_t sunrise, sunset;
+            sunsetsunrise::NextSunriseAndSunset<double>(firstDay + day, latDeg, lonDeg, sunsetsunrise::eDawn::CIVIL, sunrise, sunset);
+            hostbench::DoNotOptimize(sunrise);
+            hostbench::DoNotOptimize(sunset);
+            day = day + 1 == scheduler::EPHEMERIS_DAYS ? 0 : day + 1;
+        } });
+
+    day = 0;
+    double lookupAllocs = hostbench::Run("ephemeris/Lookup", [&](uint64_t n)
+                                         {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            time_t sunrise, sunset;
+            ephemeris.Lookup(firstDay + day, sunrise, sunset);
+            hostbench::DoNotOptimize(sunrise);
+            hostbench::DoNotOptimize(sunset);
+            day = day + 1 == scheduler::EPHEMERIS_DAYS ? 0 : day + 1;
+        } });
+    hostbench::Expect(lookupAllocs == 0, "Lookup does not allocate");
+
+    // Start, Standortwechsel und einmal im Jahr
+    hostbench::Run("ephemeris/Build_366_days", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++)
+            ephemeris.Build(firstDay); });
+
+    return hostbench::Finish();
+}
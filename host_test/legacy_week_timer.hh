@@ -0,0 +1,30 @@
+#pragma once
+// Die bis zur Wochen-Offset-Fassung benutzte Auswertung von OneWeekIn15MinutesTimer (ein Byte je zwei Stunden,
+// Tag/Stunde/Minute aus localtime) als Referenz fuer Tests und Benchmark
+#include <cstdint>
+#include <array>
+
+namespace legacy
+{
+    inline uint16_t WeekTimerValue(const std::array<uint8_t, 84> &data, int d, int h, int m)
+    {
+        uint8_t twoHours = data[d * 12 + (h >> 1)];
+        uint8_t fifteenMinutesSlot = 4 * (h & 1) + (m / 15);
+        return (twoHours & (1 << fifteenMinutesSlot)) ? UINT16_MAX : 0;
+    }
+
+    // Slot fuer Slot bis zum naechsten abweichenden Wert, hoechstens eine Woche weit
+    inline uint32_t SecondsToNextChange(const std::array<uint8_t, 84> &data, uint32_t weekSecs)
+    {
+        constexpr uint32_t SLOT_SECS{15 * 60};
+        constexpr uint32_t SLOTS{672};
+        uint32_t slot = weekSecs / SLOT_SECS;
+        auto valueOf = [&](uint32_t s)
+        { s %= SLOTS; return WeekTimerValue(data, s / 96, (s % 96) / 4, (s % 4) * 15); };
+        uint16_t now = valueOf(slot);
+        for (uint32_t k = 1; k < SLOTS; k++)
+            if (valueOf(slot + k) != now)
+                return k * SLOT_SECS - weekSecs % SLOT_SECS;
+        return UINT32_MAX;
+    }
+}
@@ -0,0 +1,137 @@
+// Benchmark Scheduler-Start mit 100 in NVS gespeicherten Schedules (NVS-Stand-in im RAM): Scheduler::Begin indiziert
+// nur die Schluessel, gegen den vormaligen Start, der zusaetzlich jeden Blob gelesen, dekodiert und daraus einen Timer
+// gebaut hat. Auf dem Chip liest NVS aus dem Flash, der Unterschied ist dort also groesser als hier.
+// Dazu die Kosten, die der verzoegerte Start auf den ersten Zugriff verschiebt: Laden aus NVS in den TimerPool (bei
+// 100 abwechselnd benutzten Schedules und TIMER_POOL_BLOCKS Bloecken jedes Mal inkl. Verdraengen) gegen den Zugriff
+// auf einen geladenen Timer. Alle Schedules sind Wochenplaene -- SunRandom-Timer werden nie verdraengt und wuerden
+// den Pool beim reihum Zugreifen dauerhaft belegen.
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <array>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.hh"
+#include "scheduler.hh"
+
+using namespace scheduler;
+using WsProtocol::scheduler::Schedule::Payload;
+
+namespace
+{
+    constexpr size_t SCHEDULE_COUNT{100};
+    constexpr size_t PREDEFINED_COUNT{5}; // ALWAYS, NEVER, DAILY_6_22, WORKING_DAYS_7_18, TestEvenMinutesOnOddMinutesOff
+    constexpr time_t NOW{1'750'000'000};
+
+    std::string NameOf(size_t i)
+    {
+        char name[NVS_KEY_NAME_MAX_SIZE];
+        std::snprintf(name, sizeof(name), "sched%03zu", i);
+        return name;
+    }
+
+    // was der Start vor dem Lazy-Index zusaetzlich zum Indizieren je Blob getan hat: Laenge abfragen, lesen, dekodieren
+    // und den Timer bauen (hier gleich wieder freigegeben, der TimerPool fasst keine 100)
+    size_t EagerLoad(nvs_handle_t handle)
+    {
+        size_t loaded{0};
+        nvs_iterator_t it = nullptr;
+        esp_err_t res = nvs_entry_find_in_handle(handle, NVS_TYPE_BLOB, &it);
+        while (res == ESP_OK)
+        {
+            nvs_entry_info_t info;
+            nvs_entry_info(it, &info);
+            size_t len{0};
+            nvs_get_blob(handle, info.key, nullptr, &len);
+            uint8_t blob[128];
+            Payload schedule{};
+            size_t pos{0};
+            if (len <= sizeof(blob) && nvs_get_blob(handle, info.key, blob, &len) == ESP_OK && WsProtocol::scheduler::Schedule::Decode(blob, len, pos, schedule))
+            {
+                aTimer *t = Builder::BuildFromSchedule(schedule);
+                loaded += t != nullptr;
+                delete t;
+            }
+            res = nvs_entry_next(&it);
+        }
+        nvs_release_iterator(it);
+        return loaded;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    hostbench::ParseArgs(argc, argv);
+    host_log_level = ESP_LOG_ERROR;
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+
+    nvs_handle_t handle;
+    ESP_ERROR_CHECK(nvs_open("scheduler", NVS_READWRITE, &handle));
+    std::mt19937 rng(42);
+    std::vector<std::array<uint8_t, 84>> weeks(SCHEDULE_COUNT);
+    for (size_t i = 0; i < SCHEDULE_COUNT; i++)
+    {
+        for (auto &byte : weeks[i])
+            byte = rng() & rng();
+        OneWeekIn15MinutesTimer timer(NameOf(i), weeks[i]);
+        uint8_t blob[128];
+        size_t len{sizeof(blob)};
+        timer.FillNvsBlob(blob, len);
+        ESP_ERROR_CHECK(nvs_set_blob(handle, NameOf(i).c_str(), blob, len));
+    }
+    ESP_ERROR_CHECK(nvs_commit(handle));
+
+    Scheduler s(handle);
+    hostbench::Run("scheduler/Begin_index_100_schedules", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++)
+            s.Begin(); });
+
+    size_t loaded{0};
+    hostbench::Run("scheduler/Begin_plus_eager_load_100_legacy", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            s.Begin();
+            loaded = EagerLoad(handle);
+        } });
+    hostbench::Expect(loaded == SCHEDULE_COUNT, "the eager start builds every timer");
+
+    // Begin hat die Plaetze neu vergeben, Handles erst danach aufloesen
+    std::vector<std::string> names;
+    s.FillAvailableScheduleNames(names);
+    hostbench::Expect(names.size() == SCHEDULE_COUNT + PREDEFINED_COUNT, "Begin indexes every stored schedule");
+    hostbench::Expect(TimerPool::FreeBlocks() == TIMER_POOL_BLOCKS, "Begin loads no timer into the pool");
+
+    // jeder beim ersten Zugriff geladene Timer muss denselben Wert liefern wie einer direkt aus den Daten
+    std::vector<webmanager::ScheduleHandle> handles;
+    size_t mismatches{0};
+    for (size_t i = 0; i < SCHEDULE_COUNT; i++)
+    {
+        handles.push_back(s.ResolveSchedule(NameOf(i).c_str()));
+        OneWeekIn15MinutesTimer expected(NameOf(i), weeks[i]);
+        mismatches += s.GetCurrentValue(handles[i], NOW) != expected.GetCachedValue(NOW);
+    }
+    hostbench::Expect(mismatches == 0, "schedules loaded on first use have the stored value");
+    hostbench::Expect(TimerPool::FreeBlocks() == 0, "loading more schedules than pool blocks fills the pool");
+
+    // reihum ueber alle 100: jeder Zugriff laedt aus NVS und verdraengt den am laengsten nicht benutzten Timer
+    size_t next{0};
+    hostbench::Run("scheduler/GetCurrentValue_first_use_load_evict", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            hostbench::DoNotOptimize(s.GetCurrentValue(handles[next], NOW));
+            next = next + 1 == SCHEDULE_COUNT ? 0 : next + 1;
+        } });
+
+    hostbench::Run("scheduler/GetCurrentValue_loaded", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++)
+            hostbench::DoNotOptimize(s.GetCurrentValue(handles[0], NOW)); });
+
+    return hostbench::Finish();
+}
@@ -0,0 +1,85 @@
+// Microbenchmark OneWeekIn15MinutesTimer: vormaliger Pfad (localtime je Aufruf, Byte-Auswertung) gegen
+// Wochen-Offset-Auswertung, gecachten Wert und wortweise gegen Slot-fuer-Slot-Suche nach dem naechsten Wechsel.
+// Die Zeit laeuft je Iteration eine Sekunde weiter, wie beim sekuendlichen Aufruf aus Scheduler::Loop.
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <array>
+#include <random>
+#include "bench.hh"
+#include "legacy_week_timer.hh"
+#include "scheduler_timers.hh"
+
+using scheduler::OneWeekIn15MinutesTimer;
+
+int main(int argc, char **argv)
+{
+    hostbench::ParseArgs(argc, argv);
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+
+    std::array<uint8_t, 84> data;
+    std::mt19937 rng(42);
+    for (auto &byte : data)
+        byte = rng() & rng() & rng(); // einige Wechsel am Tag, teils lange Strecken ohne
+    OneWeekIn15MinutesTimer timer("bench", data);
+    const time_t start{1'700'000'000};
+
+    time_t t = start;
+    hostbench::Run("week_timer/localtime_legacy_byte_index", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++, t++)
+        {
+            struct tm local;
+            localtime_r(&t, &local);
+            hostbench::DoNotOptimize(legacy::WeekTimerValue(data, local.tm_wday, local.tm_hour, local.tm_min));
+        } });
+
+    t = start;
+    hostbench::Run("week_timer/localtime_GetCurrentValue", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++, t++)
+        {
+            struct tm local;
+            localtime_r(&t, &local);
+            hostbench::DoNotOptimize(timer.GetCurrentValue(t, local.tm_wday, local.tm_hour, local.tm_min, local.tm_sec));
+        } });
+
+    uint32_t weekSecs{0};
+    hostbench::Run("week_timer/GetValueAtWeekOffset", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            hostbench::DoNotOptimize(timer.GetValueAtWeekOffset(weekSecs));
+            weekSecs = weekSecs + 1 == OneWeekIn15MinutesTimer::SECONDS_PER_WEEK ? 0 : weekSecs + 1;
+        } });
+
+    t = start;
+    hostbench::Run("week_timer/GetCachedValue", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++, t++)
+            hostbench::DoNotOptimize(timer.GetCachedValue(t)); });
+
+    // Suche nach dem naechsten Wechsel von jeder Viertelstunde der Woche aus
+    uint32_t slot{0};
+    uint64_t mismatches{0};
+    hostbench::Run("week_timer/SecondsToNextChange_word_ctz", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            hostbench::DoNotOptimize(timer.SecondsToNextChange(slot * 900));
+            slot = slot + 1 == 672 ? 0 : slot + 1;
+        } });
+    slot = 0;
+    hostbench::Run("week_timer/SecondsToNextChange_slot_scan", [&](uint64_t n)
+                   {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            uint32_t expected = legacy::SecondsToNextChange(data, slot * 900);
+            hostbench::DoNotOptimize(expected);
+            mismatches += expected != timer.SecondsToNextChange(slot * 900);
+            slot = slot + 1 == 672 ? 0 : slot + 1;
+        } });
+    hostbench::Expect(mismatches == 0, "word search matches the slot scan");
+    return hostbench::Finish();
+}
@@ -0,0 +1,165 @@
+// Host-Tests fuer OneWeekIn15MinutesTimer: Wochen-Offset-Auswertung und wortweise Suche nach dem naechsten Wechsel
+// gegen die vormalige Byte-Auswertung bzw. eine Slot-fuer-Slot-Suche, ueber alle 672 Slots verschiedener Plaene,
+// sowie die Begrenzung auf eine Stunde vor einer Sommer-/Winterzeit-Umstellung.
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <array>
+#include <random>
+#include "bench.hh"
+#include "legacy_week_timer.hh"
+#include "scheduler_timers.hh"
+
+using scheduler::OneWeekIn15MinutesTimer;
+using Bitmap = std::array<uint8_t, 84>;
+
+namespace
+{
+    constexpr uint32_t SLOTS{672};
+    constexpr uint32_t SLOT_SECS{15 * 60};
+
+    Bitmap filled(uint8_t v)
+    {
+        Bitmap b;
+        b.fill(v);
+        return b;
+    }
+
+    Bitmap withSlots(uint8_t background, std::initializer_list<uint32_t> slots)
+    {
+        Bitmap b = filled(background);
+        for (uint32_t s : slots)
+            b[s >> 3] ^= 1 << (s & 7);
+        return b;
+    }
+
+    // alle 672 Slots, je Slot Anfang, Mitte und letzte Sekunde
+    void checkAllSlots(const Bitmap &data, const char *what)
+    {
+        OneWeekIn15MinutesTimer timer("test", data);
+        int errorsBefore = hostbench::failures;
+        for (uint32_t slot = 0; slot < SLOTS && hostbench::failures == errorsBefore; slot++)
+        {
+            int d = slot / 96;
+            int h = (slot % 96) / 4;
+            for (uint32_t s : {0u, 1u, 451u, SLOT_SECS - 1})
+            {
+                uint32_t weekSecs = slot * SLOT_SECS + s;
+                int m = (slot % 4) * 15 + s / 60;
+                uint16_t expected = legacy::WeekTimerValue(data, d, h, m);
+                hostbench::Expect(timer.GetCurrentValue(0, d, h, m, s % 60) == expected, what);
+                hostbench::Expect(timer.GetValueAtWeekOffset(weekSecs) == expected, what);
+                hostbench::Expect(timer.SecondsToNextChange(weekSecs) == legacy::SecondsToNextChange(data, weekSecs), what);
+            }
+        }
+    }
+
+    void testBitmaps()
+    {
+        checkAllSlots(filled(0x00), "all off");
+        checkAllSlots(filled(0xFF), "all on");
+        checkAllSlots(filled(0x55), "alternating slots");
+        checkAllSlots(filled(0x0F), "alternating hours");
+        checkAllSlots(withSlots(0x00, {0}), "only the first slot of the week");
+        checkAllSlots(withSlots(0x00, {SLOTS - 1}), "only the last slot of the week");
+        checkAllSlots(withSlots(0xFF, {31, 32}), "off across a word boundary");
+        checkAllSlots(withSlots(0x00, {0, SLOTS - 1}), "on across the end of the week");
+        // jeder einzelne Slot als einziger Wechsel (und invertiert): deckt jede Bitposition jedes Worts ab
+        for (uint32_t s = 0; s < SLOTS; s++)
+        {
+            checkAllSlots(withSlots(0x00, {s}), "single slot on");
+            checkAllSlots(withSlots(0xFF, {s}), "single slot off");
+        }
+        std::mt19937 rng(4711);
+        for (int i = 0; i < 50; i++)
+        {
+            Bitmap b;
+            // duenn besetzte Plaene haben lange Strecken ohne Wechsel, also Suchen ueber mehrere Worte
+            uint32_t density = i % 5;
+            for (auto &byte : b)
+            {
+                byte = 0;
+                for (int bit = 0; bit < 8; bit++)
+                    if (rng() % 64 < (density == 0 ? 32 : density))
+                        byte |= 1 << bit;
+            }
+            checkAllSlots(b, "random plan");
+        }
+    }
+
+    // in UTC (keine Umstellung) stimmen Wert und naechster Wechsel ueber GetValueAndNextChange/GetCachedValue
+    // exakt mit der Slot-fuer-Slot-Suche ueberein
+    void testNextChangeUtc()
+    {
+        setenv("TZ", "UTC0", 1);
+        tzset();
+        std::mt19937 rng(815);
+        Bitmap data;
+        for (auto &byte : data)
+            byte = rng() & rng() & rng();
+        OneWeekIn15MinutesTimer timer("utc", data);
+        const time_t start{1'700'000'000}; // Di, 14.11.2023
+        time_t t = start;
+        int changes{0};
+        while (t < start + 8 * 86400)
+        {
+            struct tm local;
+            localtime_r(&t, &local);
+            time_t nextChange;
+            uint16_t value = timer.GetValueAndNextChange(t, local, nextChange);
+            hostbench::Expect(value == legacy::WeekTimerValue(data, local.tm_wday, local.tm_hour, local.tm_min), "value in UTC");
+            uint32_t weekSecs = OneWeekIn15MinutesTimer::WeekOffsetOf(local);
+            hostbench::Expect(nextChange - t == (time_t)legacy::SecondsToNextChange(data, weekSecs), "next change in UTC");
+            hostbench::Expect(timer.GetCachedValue(nextChange - 1) == value, "cached value until the change");
+            hostbench::Expect(timer.GetCachedValue(nextChange) != value, "value flips at the change");
+            t = nextChange;
+            changes++;
+        }
+        hostbench::Expect(changes > 8, "random plan changes several times a week");
+    }
+
+    // Sonntag 31.03.2024, Mitteleuropa: um 02:00 MEZ wird auf 03:00 MESZ gestellt. Der Plan wechselt um 12:00
+    // Ortszeit -- der Wochen-Offset rechnet 11,5h ab 00:30, tatsaechlich sind es nur 10,5h. Der naechste Wechsel
+    // wird deshalb auf eine Stunde begrenzt; in Stundenschritten weitergerechnet trifft er 12:00 MESZ exakt.
+    // Gleiches fuer die Rueckstellung am 27.10.2024 (03:00 MESZ -> 02:00 MEZ).
+    void testDstCap(time_t start, const char *what)
+    {
+        setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+        tzset();
+        Bitmap data = filled(0x00);
+        for (uint32_t slot = 48; slot < 96; slot++) // Sonntag ab 12:00
+            data[slot >> 3] |= 1 << (slot & 7);
+        OneWeekIn15MinutesTimer timer("dst", data);
+
+        struct tm local;
+        localtime_r(&start, &local);
+        time_t nextChange;
+        hostbench::Expect(timer.GetValueAndNextChange(start, local, nextChange) == 0, what);
+        hostbench::Expect(nextChange == start + 3600, what);
+
+        time_t t = start;
+        uint16_t value{0};
+        int steps{0};
+        while (value == 0 && steps < 24)
+        {
+            value = timer.GetCachedValue(t);
+            if (value == 0)
+            {
+                hostbench::Expect(timer.GetCachedValue(timer.GetCachedUntil() - 1) == 0, what);
+                t = timer.GetCachedUntil();
+            }
+            steps++;
+        }
+        localtime_r(&t, &local);
+        hostbench::Expect(value == UINT16_MAX && local.tm_wday == 0 && local.tm_hour == 12 && local.tm_min == 0 && local.tm_sec == 0, what);
+    }
+}
+
+int main()
+{
+    testBitmaps();
+    testNextChangeUtc();
+    testDstCap(1'711'841'400, "spring forward"); // 31.03.2024 00:30 MEZ
+    testDstCap(1'729'981'800, "fall back");      // 27.10.2024 00:30 MESZ
+    return hostbench::Finish();
+}
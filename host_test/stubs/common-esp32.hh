@@ -0,0 +1,8 @@
+#pragma once
+// Host-Ersatz fuer die common-Komponente: nur die Typen, die cpp/ daraus benutzt, und die Header, die cpp/timeseries.hh
+// ueber sie mitbekommt (Semaphoren)
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+typedef uint8_t u8_t;
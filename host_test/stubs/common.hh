@@ -0,0 +1,3 @@
+#pragma once
+// Host-Ersatz fuer die common-Komponente: cpp/scheduler.hh bindet den Header ein, benutzt aber nichts daraus
+#include <cstdint>
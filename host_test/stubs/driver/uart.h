@@ -0,0 +1,2 @@
+#pragma once
+// Host-Ersatz: nur damit cpp/scheduler.hh eingebunden werden kann, benutzt wird daraus nichts
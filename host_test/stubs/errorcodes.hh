@@ -0,0 +1,19 @@
+#pragma once
+// Host-Ersatz fuer die errorcodes-Komponente: nur die Codes und das Makro, die cpp/ benutzt
+#include "esp_log.h"
+
+enum class ErrorCode
+{
+    OK = 0,
+    GENERIC_ERROR,
+};
+
+#define RETURN_ERRORCODE_ON_FALSE(a, err_code, format, ...)    \
+    do                                                          \
+    {                                                           \
+        if (!(a))                                               \
+        {                                                       \
+            ESP_LOGE(TAG, format, ##__VA_ARGS__);               \
+            return err_code;                                    \
+        }                                                       \
+    } while (0)
@@ -0,0 +1,3 @@
+#pragma once
+// Host-Ersatz: nur damit cpp/timeseries.hh eingebunden werden kann
+#include <cstdint>
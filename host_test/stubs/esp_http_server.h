@@ -0,0 +1,149 @@
+#pragma once
+// Host-Ersatz fuer die Websocket-Aufrufe aus esp_http_server, die cpp/webmanager_*.hh benutzen. Statt eines
+// httpd-Tasks sammelt httpd_queue_work die Arbeit ein, host_httpd::RunQueuedWork fuehrt sie aus (wie der httpd-Task,
+// strikt nacheinander). Gesendete Frames landen nur in Zaehlern; empfangene Frames legt der Test per
+// httpd_req::incoming bereit.
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <array>
+#include <set>
+#include <utility>
+#include "esp_err.h"
+
+typedef void *httpd_handle_t;
+typedef void (*httpd_work_fn_t)(void *arg);
+
+typedef enum
+{
+    HTTPD_WS_TYPE_CONTINUE = 0x0,
+    HTTPD_WS_TYPE_TEXT = 0x1,
+    HTTPD_WS_TYPE_BINARY = 0x2,
+    HTTPD_WS_TYPE_CLOSE = 0x8,
+    HTTPD_WS_TYPE_PING = 0x9,
+    HTTPD_WS_TYPE_PONG = 0xA
+} httpd_ws_type_t;
+
+typedef enum
+{
+    HTTPD_WS_CLIENT_INVALID = 0x0,
+    HTTPD_WS_CLIENT_HTTP = 0x1,
+    HTTPD_WS_CLIENT_WEBSOCKET = 0x2,
+} httpd_ws_client_info_t;
+
+typedef struct httpd_ws_frame
+{
+    bool final;
+    bool fragmented;
+    httpd_ws_type_t type;
+    uint8_t *payload;
+    size_t len;
+} httpd_ws_frame_t;
+
+typedef struct httpd_req
+{
+    httpd_handle_t handle;
+    int method;
+    int fd;                            // nur Host: Socket des Absenders
+    const httpd_ws_frame_t *incoming;  // nur Host: der naechste von httpd_ws_recv_frame zu liefernde Frame
+} httpd_req_t;
+
+namespace host_httpd
+{
+    struct State
+    {
+        // fester Ring statt std::deque, damit der Ersatz selbst nichts allokiert (allocs/op der Benchmarks)
+        std::array<std::pair<httpd_work_fn_t, void *>, 64> work;
+        size_t workHead{0};
+        size_t workCount{0};
+        std::set<int> websockets;
+        uint64_t sentFrames{0};
+        uint64_t sentBytes{0};
+        esp_err_t sendResult{ESP_OK};
+    };
+    inline State state;
+
+    inline void SetWebsocket(int fd, bool open)
+    {
+        if (open)
+            state.websockets.insert(fd);
+        else
+            state.websockets.erase(fd);
+    }
+
+    inline size_t RunQueuedWork()
+    {
+        size_t n{0};
+        while (state.workCount)
+        {
+            auto w = state.work[state.workHead];
+            state.workHead = (state.workHead + 1) % state.work.size();
+            state.workCount--;
+            w.first(w.second);
+            n++;
+        }
+        return n;
+    }
+}
+
+inline int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    return r->fd;
+}
+
+inline httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    (void)(hd);
+    return host_httpd::state.websockets.count(fd) ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_INVALID;
+}
+
+inline esp_err_t httpd_queue_work(httpd_handle_t hd, httpd_work_fn_t work, void *arg)
+{
+    (void)(hd);
+    auto &st = host_httpd::state;
+    if (st.workCount == st.work.size())
+        return ESP_FAIL;
+    st.work[(st.workHead + st.workCount) % st.work.size()] = {work, arg};
+    st.workCount++;
+    return ESP_OK;
+}
+
+inline esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    (void)(hd);
+    if (!host_httpd::state.websockets.count(fd))
+        return ESP_FAIL;
+    if (host_httpd::state.sendResult == ESP_OK)
+    {
+        host_httpd::state.sentFrames++;
+        host_httpd::state.sentBytes += frame->len;
+    }
+    return host_httpd::state.sendResult;
+}
+
+inline esp_err_t httpd_sess_trigger_close(httpd_handle_t hd, int fd)
+{
+    (void)(hd);
+    host_httpd::SetWebsocket(fd, false);
+    return ESP_OK;
+}
+
+// max_len == 0: nur Kopf (Typ, final, Laenge); sonst Payload nach frame->payload kopieren
+inline esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *frame, size_t max_len)
+{
+    if (!req->incoming)
+        return ESP_ERR_INVALID_STATE;
+    if (max_len == 0)
+    {
+        frame->final = req->incoming->final;
+        frame->fragmented = req->incoming->fragmented;
+        frame->type = req->incoming->type;
+        frame->len = req->incoming->len;
+        return ESP_OK;
+    }
+    if (max_len < req->incoming->len)
+        return ESP_ERR_INVALID_SIZE;
+    std::memcpy(frame->payload, req->incoming->payload, req->incoming->len);
+    frame->len = req->incoming->len;
+    return ESP_OK;
+}
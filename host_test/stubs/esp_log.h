@@ -0,0 +1,29 @@
+#pragma once
+// Host-Ersatz: Ausgabe auf stderr bis einschliesslich host_log_level (Standard: Fehler und Warnungen)
+#include <cstdio>
+
+typedef enum
+{
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+// Benchmarks setzen ESP_LOG_ERROR, damit erwartete Warnungen (Pool erschoepft o.ae.) die Messung nicht verfaelschen
+inline esp_log_level_t host_log_level{ESP_LOG_WARN};
+
+#define HOST_LOG_(level, letter, tag, format, ...)                                     \
+    do                                                                                 \
+    {                                                                                  \
+        if (host_log_level >= level)                                                   \
+            std::fprintf(stderr, letter " (%s) " format "\n", tag, ##__VA_ARGS__);      \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG_(ESP_LOG_ERROR, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG_(ESP_LOG_WARN, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG_(ESP_LOG_INFO, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG_(ESP_LOG_DEBUG, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) HOST_LOG_(ESP_LOG_VERBOSE, "V", tag, format, ##__VA_ARGS__)
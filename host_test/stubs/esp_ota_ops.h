@@ -0,0 +1,3 @@
+#pragma once
+// Host-Ersatz: nur damit cpp/timeseries.hh eingebunden werden kann, OTA gibt es auf dem Host nicht
+#include "esp_partition.h"
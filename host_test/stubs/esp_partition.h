@@ -0,0 +1,191 @@
+#pragma once
+// Host-Ersatz fuer esp_partition: Partitionen liegen als Puffer im RAM und werden von Tests/Benchmarks per
+// host_partition::Add angelegt. Schreiben verhaelt sich wie NOR-Flash (Bits nur von 1 nach 0, also UND mit dem
+// Inhalt), Loeschen geht nur in ganzen 4k-Sektoren und setzt 0xFF. esp_partition_mmap liefert direkt den Puffer --
+// Schreibzugriffe sind damit sofort sichtbar wie nach dem Cache-Invalidieren auf dem Chip.
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "esp_err.h"
+
+typedef enum
+{
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+    ESP_PARTITION_TYPE_ANY = 0xff,
+} esp_partition_type_t;
+
+typedef enum
+{
+    ESP_PARTITION_SUBTYPE_APP_FACTORY = 0x00,
+    ESP_PARTITION_SUBTYPE_APP_OTA_MIN = 0x10,
+    ESP_PARTITION_SUBTYPE_APP_OTA_MAX = 0x20,
+    ESP_PARTITION_SUBTYPE_DATA_OTA = 0x00,
+    ESP_PARTITION_SUBTYPE_DATA_NVS = 0x02,
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+typedef enum
+{
+    ESP_PARTITION_MMAP_DATA,
+    ESP_PARTITION_MMAP_INST,
+} esp_partition_mmap_memory_t;
+
+typedef uint32_t esp_partition_mmap_handle_t;
+
+typedef struct
+{
+    void *flash_chip;
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    uint32_t erase_size;
+    char label[17];
+    bool encrypted;
+    bool readonly;
+} esp_partition_t;
+
+namespace host_partition
+{
+    constexpr uint32_t SECTOR_SIZE{4096};
+
+    struct Partition
+    {
+        esp_partition_t info;
+        std::vector<uint8_t> flash;
+        // Zaehler fuer Tests und Benchmarks
+        uint32_t writes{0};
+        uint32_t erases{0};
+        uint64_t writtenBytes{0};
+    };
+
+    // deque: Adressen bleiben beim Anlegen weiterer Partitionen gueltig
+    inline std::deque<Partition> table;
+
+    // legt eine geloeschte (0xFF) Partition an; 'size' wird auf ganze Sektoren aufgerundet
+    inline Partition &Add(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label, uint32_t size)
+    {
+        size = (size + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE;
+        uint32_t address = table.empty() ? 0x10000 : table.back().info.address + table.back().info.size;
+        Partition &p = table.emplace_back();
+        p.info = esp_partition_t{nullptr, type, subtype, address, size, SECTOR_SIZE, {}, false, false};
+        std::strncpy(p.info.label, label, sizeof(p.info.label) - 1);
+        p.flash.assign(size, 0xFF);
+        return p;
+    }
+
+    inline void Reset() { table.clear(); }
+
+    inline Partition *Of(const esp_partition_t *partition)
+    {
+        for (Partition &p : table)
+            if (&p.info == partition)
+                return &p;
+        return nullptr;
+    }
+
+    inline bool Matches(const Partition &p, esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+    {
+        return (type == ESP_PARTITION_TYPE_ANY || p.info.type == type) &&
+               (subtype == ESP_PARTITION_SUBTYPE_ANY || p.info.subtype == subtype) &&
+               (!label || std::strcmp(p.info.label, label) == 0);
+    }
+}
+
+struct esp_partition_iterator_opaque_
+{
+    size_t index;
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    const char *label;
+};
+typedef esp_partition_iterator_opaque_ *esp_partition_iterator_t;
+
+inline esp_partition_iterator_t esp_partition_next(esp_partition_iterator_t it)
+{
+    for (it->index++; it->index < host_partition::table.size(); it->index++)
+        if (host_partition::Matches(host_partition::table[it->index], it->type, it->subtype, it->label))
+            return it;
+    delete it;
+    return nullptr;
+}
+
+inline esp_partition_iterator_t esp_partition_find(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    // index startet "vor" dem ersten Eintrag, esp_partition_next rueckt auf den ersten passenden vor
+    return esp_partition_next(new esp_partition_iterator_opaque_{SIZE_MAX, type, subtype, label});
+}
+
+inline const esp_partition_t *esp_partition_get(esp_partition_iterator_t it)
+{
+    return &host_partition::table[it->index].info;
+}
+
+inline void esp_partition_iterator_release(esp_partition_iterator_t it)
+{
+    delete it;
+}
+
+inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label)
+{
+    for (host_partition::Partition &p : host_partition::table)
+        if (host_partition::Matches(p, type, subtype, label))
+            return &p.info;
+    return nullptr;
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    host_partition::Partition *p = host_partition::Of(partition);
+    if (!p || !dst)
+        return ESP_ERR_INVALID_ARG;
+    if (src_offset + size > p->flash.size())
+        return ESP_ERR_INVALID_SIZE;
+    std::memcpy(dst, p->flash.data() + src_offset, size);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    host_partition::Partition *p = host_partition::Of(partition);
+    if (!p || !src)
+        return ESP_ERR_INVALID_ARG;
+    if (dst_offset + size > p->flash.size())
+        return ESP_ERR_INVALID_SIZE;
+    const uint8_t *s = static_cast<const uint8_t *>(src);
+    for (size_t i = 0; i < size; i++)
+        p->flash[dst_offset + i] &= s[i];
+    p->writes++;
+    p->writtenBytes += size;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    host_partition::Partition *p = host_partition::Of(partition);
+    if (!p)
+        return ESP_ERR_INVALID_ARG;
+    if (offset % host_partition::SECTOR_SIZE != 0 || size % host_partition::SECTOR_SIZE != 0)
+        return ESP_ERR_INVALID_ARG;
+    if (offset + size > p->flash.size())
+        return ESP_ERR_INVALID_SIZE;
+    std::memset(p->flash.data() + offset, 0xFF, size);
+    p->erases += size / host_partition::SECTOR_SIZE;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size, esp_partition_mmap_memory_t, const void **out_ptr, esp_partition_mmap_handle_t *out_handle)
+{
+    host_partition::Partition *p = host_partition::Of(partition);
+    if (!p || !out_ptr || !out_handle)
+        return ESP_ERR_INVALID_ARG;
+    if (offset + size > p->flash.size())
+        return ESP_ERR_INVALID_SIZE;
+    *out_ptr = p->flash.data() + offset;
+    *out_handle = 0;
+    return ESP_OK;
+}
+
+inline void esp_partition_munmap(esp_partition_mmap_handle_t) {}
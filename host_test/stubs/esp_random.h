@@ -0,0 +1,9 @@
+#pragma once
+#include <cstdint>
+#include <random>
+
+inline uint32_t esp_random()
+{
+    static std::mt19937 gen{42};
+    return gen();
+}
@@ -0,0 +1,25 @@
+#pragma once
+// Host-Ersatz: Shutdown-Handler werden nur gesammelt; esp_restart ruft sie auf und beendet den Prozess
+#include <cstdlib>
+#include <vector>
+#include "esp_err.h"
+
+typedef void (*shutdown_handler_t)(void);
+
+namespace host_system
+{
+    inline std::vector<shutdown_handler_t> shutdownHandlers;
+}
+
+inline esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle)
+{
+    host_system::shutdownHandlers.push_back(handle);
+    return ESP_OK;
+}
+
+[[noreturn]] inline void esp_restart()
+{
+    for (shutdown_handler_t h : host_system::shutdownHandlers)
+        h();
+    std::exit(0);
+}
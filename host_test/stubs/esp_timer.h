@@ -0,0 +1,114 @@
+#pragma once
+// Host-Ersatz fuer esp_timer. Die Zeit ist die steady_clock des Hosts plus einem Versatz, den Tests per
+// host_esp_timer::Advance vorstellen koennen; faellige Timer-Callbacks laufen dabei synchron im Aufrufer (auf dem Chip
+// im esp_timer-Task). Ohne Advance laeuft nie ein Callback -- die Benchmarks messen so nur ihren eigenen Code.
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include "esp_err.h"
+
+namespace host_esp_timer
+{
+    inline int64_t offsetUs{0};
+}
+
+inline int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() + host_esp_timer::offsetUs;
+}
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer
+{
+    esp_timer_create_args_t args;
+    int64_t dueUs;    // -1 = gestoppt
+    int64_t periodUs; // 0 = einmalig
+};
+typedef esp_timer *esp_timer_handle_t;
+
+namespace host_esp_timer
+{
+    inline std::list<esp_timer> timers;
+
+    // stellt die Uhr um 'us' vor und ruft dabei alle faelligen Callbacks in zeitlicher Reihenfolge auf; ein
+    // periodischer Timer mit skip_unhandled_events holt verpasste Perioden nicht nach
+    inline void Advance(int64_t us)
+    {
+        const int64_t endUs = esp_timer_get_time() + us;
+        while (true)
+        {
+            esp_timer *next{nullptr};
+            for (esp_timer &t : timers)
+                if (t.dueUs >= 0 && t.dueUs <= endUs && (!next || t.dueUs < next->dueUs))
+                    next = &t;
+            if (!next)
+                break;
+            offsetUs += std::max<int64_t>(0, next->dueUs - esp_timer_get_time());
+            if (next->periodUs == 0)
+                next->dueUs = -1;
+            else
+                next->dueUs += next->periodUs;
+            next->args.callback(next->args.arg);
+        }
+        offsetUs += std::max<int64_t>(0, endUs - esp_timer_get_time());
+    }
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (!create_args || !create_args->callback || !out_handle)
+        return ESP_ERR_INVALID_ARG;
+    *out_handle = &host_esp_timer::timers.emplace_back(esp_timer{*create_args, -1, 0});
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->dueUs >= 0)
+        return ESP_ERR_INVALID_STATE;
+    timer->dueUs = esp_timer_get_time() + (int64_t)timeout_us;
+    timer->periodUs = 0;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    if (timer->dueUs >= 0)
+        return ESP_ERR_INVALID_STATE;
+    timer->dueUs = esp_timer_get_time() + (int64_t)period;
+    timer->periodUs = (int64_t)period;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer->dueUs < 0)
+        return ESP_ERR_INVALID_STATE;
+    timer->dueUs = -1;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer->dueUs >= 0)
+        return ESP_ERR_INVALID_STATE;
+    host_esp_timer::timers.remove_if([timer](const esp_timer &t) { return &t == timer; });
+    return ESP_OK;
+}
@@ -0,0 +1,2 @@
+#pragma once
+#define ESP_VFS_PATH_MAX 15
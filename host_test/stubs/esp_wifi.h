@@ -0,0 +1,13 @@
+#pragma once
+// Host-Ersatz: webmanager_constants.hh braucht nur den Typ des AP-Authmodus (und ueber ihn sdkconfig/esp_vfs)
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "esp_vfs.h"
+
+typedef enum
+{
+    WIFI_AUTH_OPEN = 0,
+    WIFI_AUTH_WEP,
+    WIFI_AUTH_WPA_PSK,
+    WIFI_AUTH_WPA2_PSK,
+} wifi_auth_mode_t;
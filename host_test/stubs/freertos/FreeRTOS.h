@@ -0,0 +1,43 @@
+#pragma once
+// Host-Ersatz fuer die von cpp/ benutzten FreeRTOS-Typen und -Makros. portMUX_TYPE ist ein echter Spinlock,
+// damit die Benchmarks die Kosten der kritischen Abschnitte mitmessen.
+#include <cstdint>
+#include <atomic>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY UINT32_MAX
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define IRAM_ATTR
+
+struct portMUX_TYPE
+{
+    std::atomic_flag flag;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+inline void host_port_enter_critical(portMUX_TYPE *m)
+{
+    while (m->flag.test_and_set(std::memory_order_acquire))
+    {
+    }
+}
+
+inline void host_port_exit_critical(portMUX_TYPE *m)
+{
+    m->flag.clear(std::memory_order_release);
+}
+
+#define portENTER_CRITICAL(m) host_port_enter_critical(m)
+#define portEXIT_CRITICAL(m) host_port_exit_critical(m)
+#define portENTER_CRITICAL_ISR(m) host_port_enter_critical(m)
+#define portEXIT_CRITICAL_ISR(m) host_port_exit_critical(m)
+#define portYIELD_FROM_ISR(x) ((void)(x))
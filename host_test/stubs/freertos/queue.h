@@ -0,0 +1,3 @@
+#pragma once
+// Host-Ersatz: cpp/timeseries.hh bindet den Header ein, benutzt aber nur die eigene SpscQueue
+#include "FreeRTOS.h"
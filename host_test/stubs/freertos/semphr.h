@@ -0,0 +1,32 @@
+#pragma once
+// Host-Ersatz fuer FreeRTOS-Semaphoren auf Basis von std::recursive_timed_mutex (Mutex, rekursiver Mutex und
+// binaere Semaphore werden gleich behandelt -- fuer die Host-Tests genuegt gegenseitiger Ausschluss).
+#include <mutex>
+#include <chrono>
+#include "FreeRTOS.h"
+
+typedef std::recursive_timed_mutex *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new std::recursive_timed_mutex(); }
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new std::recursive_timed_mutex(); }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new std::recursive_timed_mutex(); }
+inline void vSemaphoreDelete(SemaphoreHandle_t s) { delete s; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        s->lock();
+        return pdTRUE;
+    }
+    return s->try_lock_for(std::chrono::milliseconds(ticks)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    s->unlock();
+    return pdTRUE;
+}
+
+#define xSemaphoreTakeRecursive(s, ticks) xSemaphoreTake(s, ticks)
+#define xSemaphoreGiveRecursive(s) xSemaphoreGive(s)
@@ -0,0 +1,59 @@
+#pragma once
+// Host-Ersatz fuer FreeRTOS-Tasks: ein Task ist ein losgeloester std::thread, die Task-Notification ein Zaehler mit
+// Bedingungsvariable
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+
+// steht, bis ein Test sie vorstellt (s. host_freertos_timers::Advance in timers.h)
+inline TickType_t host_freertos_ticks{0};
+
+inline TickType_t xTaskGetTickCount() { return host_freertos_ticks; }
+
+struct host_task_
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint32_t notifications{0};
+};
+inline thread_local host_task_ *host_current_task{nullptr};
+
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *, uint32_t, void *arg, UBaseType_t, TaskHandle_t *created)
+{
+    host_task_ *task = new host_task_();
+    if (created)
+        *created = task;
+    std::thread([task, fn, arg]()
+                {
+        host_current_task = task;
+        fn(arg); })
+        .detach();
+    return pdPASS;
+}
+
+inline void xTaskNotifyGive(TaskHandle_t handle)
+{
+    host_task_ *task = static_cast<host_task_ *>(handle);
+    {
+        std::lock_guard<std::mutex> lock(task->mutex);
+        task->notifications++;
+    }
+    task->cv.notify_one();
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    host_task_ *task = host_current_task;
+    std::unique_lock<std::mutex> lock(task->mutex);
+    auto ready = [task]() { return task->notifications > 0; };
+    if (ticksToWait == portMAX_DELAY)
+        task->cv.wait(lock, ready);
+    else if (!task->cv.wait_for(lock, std::chrono::milliseconds(ticksToWait), ready))
+        return 0;
+    uint32_t count = task->notifications;
+    task->notifications = clearCountOnExit ? 0 : count - 1;
+    return count;
+}
@@ -0,0 +1,89 @@
+#pragma once
+// Host-Ersatz fuer FreeRTOS-Software-Timer. Die Ticks (s. task.h) zaehlt host_freertos_timers::Advance hoch, faellige Callbacks
+// laufen dabei synchron im Aufrufer (auf dem Chip im Timer-Task); xTimer*-Aufrufe wirken sofort statt ueber die
+// Befehlswarteschlange des Timer-Tasks.
+#include <algorithm>
+#include <list>
+#include "FreeRTOS.h"
+#include "task.h"
+
+struct host_freertos_timer_
+{
+    const char *name;
+    TickType_t period;
+    bool autoReload;
+    void *id;
+    void (*callback)(host_freertos_timer_ *);
+    bool active;
+    TickType_t due;
+};
+typedef host_freertos_timer_ *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t xTimer);
+
+namespace host_freertos_timers
+{
+    inline std::list<host_freertos_timer_> timers;
+
+    inline void Advance(TickType_t n)
+    {
+        const TickType_t end = host_freertos_ticks + n;
+        while (true)
+        {
+            host_freertos_timer_ *next{nullptr};
+            for (host_freertos_timer_ &t : timers)
+                if (t.active && t.due <= end && (!next || t.due < next->due))
+                    next = &t;
+            if (!next)
+                break;
+            host_freertos_ticks = std::max(host_freertos_ticks, next->due);
+            if (next->autoReload)
+                next->due += next->period;
+            else
+                next->active = false;
+            next->callback(next);
+        }
+        host_freertos_ticks = end;
+    }
+}
+
+inline TimerHandle_t xTimerCreate(const char *pcTimerName, TickType_t xTimerPeriodInTicks, UBaseType_t uxAutoReload, void *pvTimerID, TimerCallbackFunction_t pxCallbackFunction)
+{
+    if (xTimerPeriodInTicks == 0)
+        return nullptr;
+    return &host_freertos_timers::timers.emplace_back(host_freertos_timer_{pcTimerName, xTimerPeriodInTicks, uxAutoReload != pdFALSE, pvTimerID, pxCallbackFunction, false, 0});
+}
+
+inline BaseType_t xTimerStart(TimerHandle_t xTimer, TickType_t)
+{
+    xTimer->active = true;
+    xTimer->due = host_freertos_ticks + xTimer->period;
+    return pdPASS;
+}
+
+inline BaseType_t xTimerStop(TimerHandle_t xTimer, TickType_t)
+{
+    xTimer->active = false;
+    return pdPASS;
+}
+
+inline BaseType_t xTimerReset(TimerHandle_t xTimer, TickType_t xTicksToWait) { return xTimerStart(xTimer, xTicksToWait); }
+
+inline BaseType_t xTimerChangePeriod(TimerHandle_t xTimer, TickType_t xNewPeriod, TickType_t xTicksToWait)
+{
+    xTimer->period = xNewPeriod;
+    return xTimerStart(xTimer, xTicksToWait);
+}
+
+inline BaseType_t xTimerDelete(TimerHandle_t xTimer, TickType_t)
+{
+    host_freertos_timers::timers.remove_if([xTimer](const host_freertos_timer_ &t) { return &t == xTimer; });
+    return pdPASS;
+}
+
+inline BaseType_t xTimerIsTimerActive(TimerHandle_t xTimer) { return xTimer->active ? pdTRUE : pdFALSE; }
+inline void *pvTimerGetTimerID(TimerHandle_t xTimer) { return xTimer->id; }
+inline const char *pcTimerGetName(TimerHandle_t xTimer) { return xTimer->name; }
+
+#define xTimerStartFromISR(t, woken) xTimerStart(t, 0)
+#define xTimerStopFromISR(t, woken) xTimerStop(t, 0)
+#define xTimerResetFromISR(t, woken) xTimerReset(t, 0)
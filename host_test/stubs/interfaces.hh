@@ -0,0 +1,2 @@
+#pragma once
+// Host-Ersatz fuer interfaces.hh der Anwendung: cpp/scheduler.hh bindet den Header ein, benutzt aber nichts daraus
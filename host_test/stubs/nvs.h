@@ -0,0 +1,329 @@
+#pragma once
+// Host-Ersatz fuer NVS: je Partition und Namespace eine std::map im RAM. Geschrieben wird sofort, nvs_commit zaehlt
+// nur mit (host_nvs::commits), damit Tests pruefen koennen, wie oft committet wird. Iteriert wird in Schluesselreihenfolge.
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_BASE 0x1100
+#define ESP_ERR_NVS_NOT_INITIALIZED (ESP_ERR_NVS_BASE + 0x01)
+#define ESP_ERR_NVS_NOT_FOUND (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_TYPE_MISMATCH (ESP_ERR_NVS_BASE + 0x03)
+#define ESP_ERR_NVS_READ_ONLY (ESP_ERR_NVS_BASE + 0x04)
+#define ESP_ERR_NVS_INVALID_HANDLE (ESP_ERR_NVS_BASE + 0x07)
+#define ESP_ERR_NVS_KEY_TOO_LONG (ESP_ERR_NVS_BASE + 0x09)
+#define ESP_ERR_NVS_INVALID_NAME (ESP_ERR_NVS_BASE + 0x0b)
+#define ESP_ERR_NVS_INVALID_LENGTH (ESP_ERR_NVS_BASE + 0x0c)
+
+#define NVS_DEFAULT_PART_NAME "nvs"
+#define NVS_KEY_NAME_MAX_SIZE 16
+#define NVS_NS_NAME_MAX_SIZE NVS_KEY_NAME_MAX_SIZE
+
+typedef uint32_t nvs_handle_t;
+typedef nvs_handle_t nvs_handle;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+typedef nvs_open_mode_t nvs_open_mode;
+
+typedef enum
+{
+    NVS_TYPE_U8 = 0x01,
+    NVS_TYPE_I8 = 0x11,
+    NVS_TYPE_U16 = 0x02,
+    NVS_TYPE_I16 = 0x12,
+    NVS_TYPE_U32 = 0x04,
+    NVS_TYPE_I32 = 0x14,
+    NVS_TYPE_U64 = 0x08,
+    NVS_TYPE_I64 = 0x18,
+    NVS_TYPE_STR = 0x21,
+    NVS_TYPE_BLOB = 0x42,
+    NVS_TYPE_ANY = 0xff
+} nvs_type_t;
+
+typedef struct
+{
+    char namespace_name[NVS_NS_NAME_MAX_SIZE];
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    nvs_type_t type;
+} nvs_entry_info_t;
+
+namespace host_nvs
+{
+    struct Entry
+    {
+        nvs_type_t type;
+        std::vector<uint8_t> data;
+    };
+    using Namespace = std::map<std::string, Entry>;
+
+    struct Handle
+    {
+        std::string ns; // "partition/namespace"
+        bool writable;
+    };
+
+    inline std::map<std::string, Namespace> store;
+    inline std::vector<Handle> handles; // nvs_handle_t = Index + 1, ein geschlossenes Handle hat ns==""
+    inline uint32_t commits{0};
+
+    // alles vergessen (zwischen zwei Testfaellen)
+    inline void Reset()
+    {
+        store.clear();
+        handles.clear();
+        commits = 0;
+    }
+
+    inline Handle *Of(nvs_handle_t h)
+    {
+        if (h == 0 || h > handles.size() || handles[h - 1].ns.empty())
+            return nullptr;
+        return &handles[h - 1];
+    }
+
+    inline esp_err_t Set(nvs_handle_t h, const char *key, nvs_type_t type, const void *value, size_t length)
+    {
+        Handle *handle = Of(h);
+        if (!handle)
+            return ESP_ERR_NVS_INVALID_HANDLE;
+        if (!handle->writable)
+            return ESP_ERR_NVS_READ_ONLY;
+        if (std::strlen(key) >= NVS_KEY_NAME_MAX_SIZE)
+            return ESP_ERR_NVS_KEY_TOO_LONG;
+        const uint8_t *p = static_cast<const uint8_t *>(value);
+        store[handle->ns][key] = Entry{type, std::vector<uint8_t>(p, p + length)};
+        return ESP_OK;
+    }
+
+    inline esp_err_t Get(nvs_handle_t h, const char *key, nvs_type_t type, const Entry *&entry)
+    {
+        Handle *handle = Of(h);
+        if (!handle)
+            return ESP_ERR_NVS_INVALID_HANDLE;
+        auto ns = store.find(handle->ns);
+        if (ns == store.end())
+            return ESP_ERR_NVS_NOT_FOUND;
+        auto e = ns->second.find(key);
+        if (e == ns->second.end())
+            return ESP_ERR_NVS_NOT_FOUND;
+        if (e->second.type != type)
+            return ESP_ERR_NVS_TYPE_MISMATCH;
+        entry = &e->second;
+        return ESP_OK;
+    }
+
+    // Blob und String: out==nullptr fragt nur die Laenge ab, ein zu kleiner Puffer ist ein Fehler
+    inline esp_err_t GetVariable(nvs_handle_t h, const char *key, nvs_type_t type, void *out, size_t *length)
+    {
+        const Entry *e;
+        esp_err_t err = Get(h, key, type, e);
+        if (err != ESP_OK)
+            return err;
+        if (!out)
+        {
+            *length = e->data.size();
+            return ESP_OK;
+        }
+        if (*length < e->data.size())
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        std::memcpy(out, e->data.data(), e->data.size());
+        *length = e->data.size();
+        return ESP_OK;
+    }
+
+    template <typename V>
+    esp_err_t GetFixed(nvs_handle_t h, const char *key, nvs_type_t type, V *out)
+    {
+        const Entry *e;
+        esp_err_t err = Get(h, key, type, e);
+        if (err == ESP_OK)
+            std::memcpy(out, e->data.data(), sizeof(V));
+        return err;
+    }
+}
+
+// nvs_entry_find*/nvs_entry_next: der Iterator merkt sich den Schluessel und sucht bei jedem Schritt den naechsten
+struct nvs_opaque_iterator_t
+{
+    std::string ns;
+    nvs_type_t type;
+    std::string key;
+};
+typedef nvs_opaque_iterator_t *nvs_iterator_t;
+
+inline esp_err_t nvs_open_from_partition(const char *part_name, const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (!namespace_name || std::strlen(namespace_name) >= NVS_NS_NAME_MAX_SIZE)
+        return ESP_ERR_NVS_INVALID_NAME;
+    std::string ns = std::string(part_name) + "/" + namespace_name;
+    if (open_mode == NVS_READONLY && !host_nvs::store.contains(ns))
+        return ESP_ERR_NVS_NOT_FOUND;
+    host_nvs::handles.push_back({ns, open_mode == NVS_READWRITE});
+    *out_handle = (nvs_handle_t)host_nvs::handles.size();
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    return nvs_open_from_partition(NVS_DEFAULT_PART_NAME, namespace_name, open_mode, out_handle);
+}
+
+inline void nvs_close(nvs_handle_t handle)
+{
+    if (host_nvs::Handle *h = host_nvs::Of(handle))
+        h->ns.clear();
+}
+
+inline esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    if (!host_nvs::Of(handle))
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    host_nvs::commits++;
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    host_nvs::Handle *h = host_nvs::Of(handle);
+    if (!h)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!h->writable)
+        return ESP_ERR_NVS_READ_ONLY;
+    return host_nvs::store[h->ns].erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+inline esp_err_t nvs_erase_all(nvs_handle_t handle)
+{
+    host_nvs::Handle *h = host_nvs::Of(handle);
+    if (!h)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!h->writable)
+        return ESP_ERR_NVS_READ_ONLY;
+    host_nvs::store[h->ns].clear();
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return host_nvs::Set(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+inline esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return host_nvs::GetVariable(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
+
+inline esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return host_nvs::Set(handle, key, NVS_TYPE_STR, value, std::strlen(value) + 1);
+}
+
+inline esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return host_nvs::GetVariable(handle, key, NVS_TYPE_STR, out_value, length);
+}
+
+#define HOST_NVS_FIXED_(suffix, type, nvsType)                                                  \
+    inline esp_err_t nvs_set_##suffix(nvs_handle_t handle, const char *key, type value)         \
+    {                                                                                           \
+        return host_nvs::Set(handle, key, nvsType, &value, sizeof(value));                      \
+    }                                                                                           \
+    inline esp_err_t nvs_get_##suffix(nvs_handle_t handle, const char *key, type *out_value)    \
+    {                                                                                           \
+        return host_nvs::GetFixed(handle, key, nvsType, out_value);                             \
+    }
+HOST_NVS_FIXED_(u8, uint8_t, NVS_TYPE_U8)
+HOST_NVS_FIXED_(i8, int8_t, NVS_TYPE_I8)
+HOST_NVS_FIXED_(u16, uint16_t, NVS_TYPE_U16)
+HOST_NVS_FIXED_(i16, int16_t, NVS_TYPE_I16)
+HOST_NVS_FIXED_(u32, uint32_t, NVS_TYPE_U32)
+HOST_NVS_FIXED_(i32, int32_t, NVS_TYPE_I32)
+HOST_NVS_FIXED_(u64, uint64_t, NVS_TYPE_U64)
+HOST_NVS_FIXED_(i64, int64_t, NVS_TYPE_I64)
+#undef HOST_NVS_FIXED_
+
+inline esp_err_t nvs_release_iterator(nvs_iterator_t iterator)
+{
+    delete iterator;
+    return ESP_OK;
+}
+
+// positioniert 'it' auf den ersten passenden Eintrag hinter it->key (bzw. ab dem Anfang, wenn 'inclusive')
+inline bool host_nvs_seek_(nvs_iterator_t it, bool inclusive)
+{
+    auto ns = host_nvs::store.find(it->ns);
+    if (ns == host_nvs::store.end())
+        return false;
+    auto e = inclusive ? ns->second.lower_bound(it->key) : ns->second.upper_bound(it->key);
+    for (; e != ns->second.end(); ++e)
+    {
+        if (it->type == NVS_TYPE_ANY || e->second.type == it->type)
+        {
+            it->key = e->first;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline esp_err_t nvs_entry_find_in_handle(nvs_handle_t handle, nvs_type_t type, nvs_iterator_t *output_iterator)
+{
+    host_nvs::Handle *h = host_nvs::Of(handle);
+    *output_iterator = nullptr;
+    if (!h)
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    nvs_iterator_t it = new nvs_opaque_iterator_t{h->ns, type, ""};
+    if (!host_nvs_seek_(it, true))
+    {
+        delete it;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *output_iterator = it;
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type, nvs_iterator_t *output_iterator)
+{
+    *output_iterator = nullptr;
+    nvs_iterator_t it = new nvs_opaque_iterator_t{std::string(part_name) + "/" + namespace_name, type, ""};
+    if (!host_nvs_seek_(it, true))
+    {
+        delete it;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *output_iterator = it;
+    return ESP_OK;
+}
+
+// wie in ESP-IDF: am Ende wird der Iterator freigegeben und auf nullptr gesetzt
+inline esp_err_t nvs_entry_next(nvs_iterator_t *iterator)
+{
+    if (!iterator || !*iterator)
+        return ESP_ERR_INVALID_ARG;
+    if (host_nvs_seek_(*iterator, false))
+        return ESP_OK;
+    delete *iterator;
+    *iterator = nullptr;
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+inline esp_err_t nvs_entry_info(const nvs_iterator_t iterator, nvs_entry_info_t *out_info)
+{
+    if (!iterator || !out_info)
+        return ESP_ERR_INVALID_ARG;
+    const std::string &ns = iterator->ns;
+    std::string name = ns.substr(ns.find('/') + 1);
+    std::strncpy(out_info->namespace_name, name.c_str(), NVS_NS_NAME_MAX_SIZE - 1);
+    out_info->namespace_name[NVS_NS_NAME_MAX_SIZE - 1] = 0;
+    std::strncpy(out_info->key, iterator->key.c_str(), NVS_KEY_NAME_MAX_SIZE - 1);
+    out_info->key[NVS_KEY_NAME_MAX_SIZE - 1] = 0;
+    out_info->type = host_nvs::store[ns][iterator->key].type;
+    return ESP_OK;
+}
@@ -0,0 +1,13 @@
+#pragma once
+// Host-Ersatz: die Partitionen der NVS-Stand-ins (nvs.h) existieren ohne Initialisierung
+#include "nvs.h"
+
+inline esp_err_t nvs_flash_init() { return ESP_OK; }
+inline esp_err_t nvs_flash_init_partition(const char *) { return ESP_OK; }
+inline esp_err_t nvs_flash_deinit() { return ESP_OK; }
+
+inline esp_err_t nvs_flash_erase()
+{
+    std::erase_if(host_nvs::store, [](const auto &ns) { return ns.first.starts_with(NVS_DEFAULT_PART_NAME "/"); });
+    return ESP_OK;
+}
@@ -0,0 +1,4 @@
+#pragma once
+// Host-Build: die Werte, die die header aus cpp/ aus der sdkconfig erwarten
+#define CONFIG_SPIFFS_OBJ_NAME_LEN 32
+#define CONFIG_HTTPD_WS_SUPPORT 1
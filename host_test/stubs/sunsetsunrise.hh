@@ -0,0 +1,63 @@
+#pragma once
+// Host-Ersatz fuer sunsetsunrise.hh aus der common-Komponente: die Signaturen, die cpp/ braucht, und die uebliche
+// Sonnenauf-/-untergangsgleichung (mittlere Anomalie, Mittelpunktsgleichung, Ekliptik, Stundenwinkel) in T -- damit
+// kostet NextSunriseAndSunset auf dem Host etwa so viel Rechnung wie das Original und liefert plausible Zeiten.
+#include <cstdint>
+#include <ctime>
+#include <cmath>
+
+typedef time_t tms_t;
+
+namespace sunsetsunrise
+{
+    enum class eDawn
+    {
+        CIVIL,
+        NAUTICAL,
+        ASTRONOMICAL,
+        NONE, // Sonnenrand am Horizont inkl. Refraktion
+    };
+
+    inline uint32_t JulianDate(time_t unixSecs)
+    {
+        return (uint32_t)(unixSecs / 86400 + 2440588);
+    }
+
+    template <typename T>
+    void NextSunriseAndSunset(uint32_t julianDay, T latDeg, T lonDeg, eDawn dawn, time_t &sunrise, time_t &sunset)
+    {
+        const T deg = (T)(3.14159265358979323846 / 180.0);
+        T elevationDeg;
+        switch (dawn)
+        {
+        case eDawn::CIVIL:
+            elevationDeg = -6;
+            break;
+        case eDawn::NAUTICAL:
+            elevationDeg = -12;
+            break;
+        case eDawn::ASTRONOMICAL:
+            elevationDeg = -18;
+            break;
+        default:
+            elevationDeg = (T)-0.833;
+            break;
+        }
+        T n = (T)((int32_t)julianDay - 2451545) + (T)0.0008;
+        T meanSolarNoon = n - lonDeg / 360;
+        T meanAnomaly = std::fmod((T)357.5291 + (T)0.98560028 * meanSolarNoon, (T)360);
+        T m = meanAnomaly * deg;
+        T center = (T)1.9148 * std::sin(m) + (T)0.02 * std::sin(2 * m) + (T)0.0003 * std::sin(3 * m);
+        T eclipticLongitude = std::fmod(meanAnomaly + center + 180 + (T)102.9372, (T)360) * deg;
+        T transit = meanSolarNoon + (T)0.0053 * std::sin(m) - (T)0.0069 * std::sin(2 * eclipticLongitude); // Tage ab J2000
+        T sinDeclination = std::sin(eclipticLongitude) * std::sin((T)23.4397 * deg);
+        T cosDeclination = std::sqrt(1 - sinDeclination * sinDeclination);
+        T cosHourAngle = (std::sin(elevationDeg * deg) - std::sin(latDeg * deg) * sinDeclination) / (std::cos(latDeg * deg) * cosDeclination);
+        // Polartag/-nacht: Auf- und Untergang fallen auf den Mittag bzw. liegen 24h auseinander
+        cosHourAngle = cosHourAngle < -1 ? -1 : (cosHourAngle > 1 ? 1 : cosHourAngle);
+        T halfDay = std::acos(cosHourAngle) / deg / 360;
+        // J2000 = 2000-01-01 12:00 UTC = 946728000
+        sunrise = (time_t)946728000 + (time_t)std::llround((transit - halfDay) * 86400);
+        sunset = (time_t)946728000 + (time_t)std::llround((transit + halfDay) * 86400);
+    }
+}
@@ -0,0 +1,259 @@
+#pragma once
+// Host-Ersatz fuer das aus best_binary_buffers_schema generierte ws_protocol.hh (liegt nicht im Repository).
+// Nachgebildet ist nur der Namespace 'scheduler', soweit scheduler_timers.hh und scheduler.hh ihn benutzen:
+//  - Schedule und seine Varianten (NVS-Blob, Save-Elemente) in einem einfachen eigenen Format -- NICHT dem des
+//    Generators, aber genug, damit der Scheduler Schedules in NVS ablegen und daraus laden kann:
+//      Variante = Tag (ScheduleType) + Felder, Schedule = Name mit abschliessender 0 + Laengenbyte + Variante
+//  - die Nachrichten nur als Typen: Encode liefert 0, Decode false.
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+namespace WsProtocol::scheduler
+{
+    constexpr uint16_t NAMESPACE_ID{8};
+
+    enum class ScheduleType : uint8_t
+    {
+        PREDEFINED = 0,
+        ONE_WEEK_IN_15_MINUTES = 1,
+        SUN_RANDOM = 2,
+    };
+
+    namespace OneWeekIn15Minutes
+    {
+        struct Payload
+        {
+            struct
+            {
+                uint8_t v[84];
+            } data;
+        };
+    }
+
+    namespace SunRandom
+    {
+        struct Payload
+        {
+            uint16_t offsetMinutes;
+            uint16_t randomMinutes;
+        };
+    }
+
+    namespace Predefined
+    {
+        struct Payload
+        {
+        };
+    }
+
+    // Append*: schreibt ab dest[pos] und liefert die neue Position, 0 wenn der Platz nicht reicht
+    inline size_t AppendScheduleSchedulePredefinedElement(const Predefined::Payload &, uint8_t *dest, size_t pos, size_t destSize)
+    {
+        if (pos + 1 > destSize)
+            return 0;
+        dest[pos] = (uint8_t)ScheduleType::PREDEFINED;
+        return pos + 1;
+    }
+
+    inline size_t AppendScheduleScheduleOneWeekIn15MinutesElement(const OneWeekIn15Minutes::Payload &p, uint8_t *dest, size_t pos, size_t destSize)
+    {
+        if (pos + 1 + sizeof(p.data.v) > destSize)
+            return 0;
+        dest[pos] = (uint8_t)ScheduleType::ONE_WEEK_IN_15_MINUTES;
+        std::memcpy(dest + pos + 1, p.data.v, sizeof(p.data.v));
+        return pos + 1 + sizeof(p.data.v);
+    }
+
+    inline size_t AppendScheduleScheduleSunRandomElement(const SunRandom::Payload &p, uint8_t *dest, size_t pos, size_t destSize)
+    {
+        if (pos + 5 > destSize)
+            return 0;
+        dest[pos] = (uint8_t)ScheduleType::SUN_RANDOM;
+        std::memcpy(dest + pos + 1, &p.offsetMinutes, 2);
+        std::memcpy(dest + pos + 3, &p.randomMinutes, 2);
+        return pos + 5;
+    }
+
+    // ruft fn(Variante) fuer 'count' Varianten auf; false, wenn eine nicht vollstaendig in data[0..size) liegt
+    template <typename FN>
+    bool DecodeScheduleScheduleElements(const uint8_t *data, size_t size, size_t count, FN &&fn)
+    {
+        size_t pos{0};
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!data || pos >= size)
+                return false;
+            switch ((ScheduleType)data[pos++])
+            {
+            case ScheduleType::PREDEFINED:
+            {
+                Predefined::Payload p{};
+                fn(p);
+                break;
+            }
+            case ScheduleType::ONE_WEEK_IN_15_MINUTES:
+            {
+                OneWeekIn15Minutes::Payload p{};
+                if (pos + sizeof(p.data.v) > size)
+                    return false;
+                std::memcpy(p.data.v, data + pos, sizeof(p.data.v));
+                pos += sizeof(p.data.v);
+                fn(p);
+                break;
+            }
+            case ScheduleType::SUN_RANDOM:
+            {
+                SunRandom::Payload p{};
+                if (pos + 4 > size)
+                    return false;
+                std::memcpy(&p.offsetMinutes, data + pos, 2);
+                std::memcpy(&p.randomMinutes, data + pos + 2, 2);
+                pos += 4;
+                fn(p);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+
+    namespace Schedule
+    {
+        struct Payload
+        {
+            const char *name;
+            const uint8_t *scheduleData;
+            size_t scheduleDataSize;
+        };
+
+        inline size_t Encode(const Payload &p, uint8_t *dest, size_t pos, size_t destSize)
+        {
+            size_t nameLen = std::strlen(p.name) + 1;
+            if (p.scheduleDataSize > 255 || pos + nameLen + 1 + p.scheduleDataSize > destSize)
+                return 0;
+            std::memcpy(dest + pos, p.name, nameLen);
+            pos += nameLen;
+            dest[pos++] = (uint8_t)p.scheduleDataSize;
+            std::memcpy(dest + pos, p.scheduleData, p.scheduleDataSize);
+            return pos + p.scheduleDataSize;
+        }
+
+        // name und scheduleData zeigen in 'data'
+        inline bool Decode(const uint8_t *data, size_t size, size_t &pos, Payload &p)
+        {
+            const void *end = pos < size ? std::memchr(data + pos, 0, size - pos) : nullptr;
+            if (!end)
+                return false;
+            p.name = (const char *)data + pos;
+            pos = (const uint8_t *)end - data + 1;
+            if (pos >= size || pos + 1 + data[pos] > size)
+                return false;
+            p.scheduleDataSize = data[pos++];
+            p.scheduleData = data + pos;
+            pos += p.scheduleDataSize;
+            return true;
+        }
+    }
+
+    // IScheduleContainer-Elemente (Save, SaveBatch, Open): Tag 0 = Schedule
+    inline size_t AppendResponseSchedulerOpenPayloadScheduleElement(const Schedule::Payload &p, uint8_t *dest, size_t pos, size_t destSize)
+    {
+        if (pos + 1 > destSize)
+            return 0;
+        dest[pos] = 0;
+        return Schedule::Encode(p, dest, pos + 1, destSize);
+    }
+    inline size_t AppendRequestSchedulerSavePayloadScheduleElement(const Schedule::Payload &p, uint8_t *dest, size_t pos, size_t destSize)
+    {
+        return AppendResponseSchedulerOpenPayloadScheduleElement(p, dest, pos, destSize);
+    }
+
+    template <typename FN>
+    bool DecodeScheduleContainerElements_(const uint8_t *data, size_t size, size_t count, FN &&fn)
+    {
+        size_t pos{0};
+        for (size_t i = 0; i < count; i++)
+        {
+            Schedule::Payload p{};
+            if (!data || pos >= size || data[pos++] != 0 || !Schedule::Decode(data, size, pos, p))
+                return false;
+            fn(p);
+        }
+        return true;
+    }
+
+    template <typename FN>
+    bool DecodeRequestSchedulerSavePayloadElements(const uint8_t *data, size_t size, size_t count, FN &&fn)
+    {
+        return DecodeScheduleContainerElements_(data, size, count, fn);
+    }
+
+    template <typename FN>
+    bool DecodeRequestSchedulerSaveBatchSchedulesElements(const uint8_t *data, size_t size, size_t count, FN &&fn)
+    {
+        return DecodeScheduleContainerElements_(data, size, count, fn);
+    }
+
+    namespace SchedulerListItem
+    {
+        struct Payload
+        {
+            const char *name;
+            ScheduleType type;
+        };
+    }
+
+    inline size_t AppendResponseSchedulerListItemsSchedulerListItemElement(const SchedulerListItem::Payload &item, uint8_t *dest, size_t pos, size_t destSize)
+    {
+        size_t nameLen = std::strlen(item.name) + 1;
+        if (pos + 1 + nameLen + 1 > destSize)
+            return 0;
+        dest[pos++] = 0;
+        std::memcpy(dest + pos, item.name, nameLen);
+        pos += nameLen;
+        dest[pos++] = (uint8_t)item.type;
+        return pos;
+    }
+
+    // Nachrichten: nur die Typen, s.o.
+#define HOST_WS_MESSAGE_(NAME, ID, ...)                                      \
+    namespace NAME                                                           \
+    {                                                                        \
+        constexpr uint16_t TYPE_ID{ID};                                      \
+        struct Payload                                                       \
+        {                                                                    \
+            uint16_t requestId;                                              \
+            __VA_ARGS__                                                      \
+        };                                                                   \
+        inline bool Decode(const uint8_t *, size_t, Payload &) { return false; } \
+        inline size_t Encode(const Payload &, uint8_t *, size_t) { return 0; }   \
+    }
+
+    HOST_WS_MESSAGE_(RequestSchedulerList, 1, )
+    HOST_WS_MESSAGE_(ResponseSchedulerList, 2, const uint8_t *itemsData; size_t itemsCount; size_t itemsDataSize;)
+    HOST_WS_MESSAGE_(RequestSchedulerOpen, 3, const char *name; ScheduleType type;)
+    HOST_WS_MESSAGE_(ResponseSchedulerOpen, 4, const uint8_t *payloadData; size_t payloadDataSize;)
+    HOST_WS_MESSAGE_(RequestSchedulerSave, 5, const uint8_t *payloadData; size_t payloadDataSize;)
+    HOST_WS_MESSAGE_(RequestSchedulerSaveBatch, 6, const uint8_t *schedulesData; size_t schedulesDataSize; size_t schedulesCount;)
+    HOST_WS_MESSAGE_(ResponseSchedulerSave, 7, const char *name;)
+    HOST_WS_MESSAGE_(RequestSchedulerRename, 8, const char *oldName; const char *newName;)
+    HOST_WS_MESSAGE_(RequestSchedulerDelete, 9, const char *name;)
+    HOST_WS_MESSAGE_(RequestSchedulerSubscribe, 10, const char *name; bool subscribe;)
+#undef HOST_WS_MESSAGE_
+
+    // Event: ohne requestId
+    namespace NotifyScheduleChanged
+    {
+        constexpr uint16_t TYPE_ID{11};
+        struct Payload
+        {
+            const char *name;
+            uint16_t value;
+            int64_t nextChangeEpoch;
+        };
+        inline size_t Encode(const Payload &, uint8_t *, size_t) { return 0; }
+    }
+}
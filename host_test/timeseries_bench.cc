@@ -0,0 +1,191 @@
+// Benchmark SectorCodec: Kosten je Datensatz (nur DeltaVarintCodec::Encode und der ganze Schreibpfad
+// GranularityRuntime::Write samt Pruefsumme, Staging und Flash-Stand-in) gegen die Historie, die der 16-Sektor-Ring
+// der Granularitaet TEN_SECONDS damit fasst. Datensaetze wie bei M<> mit Standardparametern: 4 Kanaele int16, MEAN.
+// Signale:
+//  - langsam: Temperatur/Feuchte, je Kanal aendert sich der 10s-Mittelwert nur gelegentlich um ein LSB
+//  - verrauscht: jeder Wert streut um mehrere hundert LSB -- der unguenstigste Fall fuer DELTA_VARINT
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.hh"
+#include "timeseries.hh"
+
+using namespace timeseries;
+
+namespace
+{
+    using RawRecord = Record<RecordLayout::MEAN, int16_t, 4>;
+    constexpr GranularityConfig CFG{GRANULARITY_CONFIG[(size_t)Granularity::TEN_SECONDS]};
+    constexpr time_t START_EPOCH{1'700'000'000};
+
+    constexpr RecordFormat Format(SectorCodec codec)
+    {
+        return RecordFormat{RecordLayout::MEAN, sizeof(RawRecord), 4, SampleType::INT16, codec};
+    }
+
+    std::vector<RawRecord> SlowSignal(size_t count)
+    {
+        std::mt19937 rng(42);
+        std::bernoulli_distribution changes(0.2);
+        std::bernoulli_distribution up(0.5);
+        int16_t v[4]{215, 480, 1013, -32}; // z.B. 21.5 Grad, 48.0 %, 1013 hPa, -3.2 Grad
+        std::vector<RawRecord> records(count);
+        for (RawRecord &r : records)
+        {
+            for (size_t c = 0; c < 4; c++)
+            {
+                if (changes(rng))
+                    v[c] += up(rng) ? 1 : -1;
+                r.mean.values[c] = v[c];
+            }
+        }
+        return records;
+    }
+
+    std::vector<RawRecord> NoisySignal(size_t count)
+    {
+        std::mt19937 rng(43);
+        std::uniform_int_distribution<int> noise(-400, 400);
+        std::vector<RawRecord> records(count);
+        for (RawRecord &r : records)
+            for (size_t c = 0; c < 4; c++)
+                r.mean.values[c] = (int16_t)(1000 * (int)c + noise(rng));
+        return records;
+    }
+
+    // frische (geloeschte) Partition in der Groesse, die M::Init verlangt, mit darauf initialisiertem 10s-Ring
+    struct Ring
+    {
+        host_partition::Partition &partition;
+        GranularityRuntime runtime;
+
+        explicit Ring(SectorCodec codec) : partition(host_partition::Add(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "timeseries", SECTOR_SIZE_BYTES * SECTORS_TOTAL)),
+                                           runtime(Granularity::TEN_SECONDS, Format(codec))
+        {
+            runtime.Init(&partition.info, partition.flash.data());
+        }
+    };
+
+    struct History
+    {
+        size_t records; // Datensaetze im Ring
+        double bytesPerRecord;
+        double hours;
+    };
+
+    // schreibt, bis der Ring mehrmals umgelaufen ist, und zaehlt dann die lesbaren Datensaetze. Der gerade beschriebene
+    // Sektor ist nur teilweise gefuellt, die Historie wird deshalb aus den vollen Sektoren hochgerechnet. Nebenbei:
+    // die gelesenen Datensaetze muessen die zuletzt geschriebenen sein.
+    History MeasureHistory(SectorCodec codec, const std::vector<RawRecord> &records, const char *what)
+    {
+        Ring ring(codec);
+        GranularityRuntime &rt = ring.runtime;
+        size_t written{0};
+        size_t wraps{0};
+        for (size_t i = 0; wraps < 3; i++, written++)
+        {
+            size_t before = rt.sectorIndex;
+            rt.Write(&ring.partition.info, START_EPOCH + (time_t)(written * CFG.SECONDS_PER_RECORD), &records[i % records.size()]);
+            if (rt.sectorIndex != before && rt.sectorIndex == CFG.SECTOR_START)
+                wraps++;
+        }
+        rt.Flush(&ring.partition.info);
+
+        size_t fullSectorRecords{0};
+        size_t fullSectors{0};
+        size_t total{0};
+        bool matches{true};
+        for (size_t k = 0; k < CFG.SECTOR_CNT; k++)
+        {
+            size_t physical = rt.PhysicalSector(k);
+            int64_t sectorEpoch = rt.SectorHeader(physical)[0];
+            size_t count{0};
+            rt.ForEachRecord(physical, 0, SIZE_MAX, [&](size_t index, const uint8_t *record)
+                             {
+                size_t n = (size_t)(sectorEpoch - START_EPOCH) / CFG.SECONDS_PER_RECORD + index;
+                matches = matches && memcmp(record, &records[n % records.size()], sizeof(RawRecord)) == 0;
+                count++;
+                return true; });
+            total += count;
+            if (physical != rt.sectorIndex)
+            {
+                fullSectorRecords += count;
+                fullSectors++;
+            }
+        }
+        hostbench::Expect(matches, what);
+        History h;
+        h.records = total;
+        double perSector = (double)fullSectorRecords / fullSectors;
+        h.bytesPerRecord = (SECTOR_SIZE_BYTES - SECTOR_HEADER_SIZE_BYTES) / perSector;
+        h.hours = perSector * CFG.SECTOR_CNT * CFG.SECONDS_PER_RECORD / 3600.0;
+        return h;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    hostbench::ParseArgs(argc, argv);
+    host_log_level = ESP_LOG_ERROR;
+
+    const std::vector<RawRecord> slow = SlowSignal(1 << 14);
+    const std::vector<RawRecord> noisy = NoisySignal(1 << 14);
+    const RecordFormat delta = Format(SectorCodec::DELTA_VARINT);
+
+    struct Case
+    {
+        const char *name;
+        const std::vector<RawRecord> *records;
+    };
+    const Case cases[]{{"slow", &slow}, {"noisy", &noisy}};
+
+    for (const Case &c : cases)
+    {
+        char name[64];
+        std::snprintf(name, sizeof(name), "timeseries/encode_delta_varint/%s", c.name);
+        uint8_t out[MAX_STAGING_BYTES];
+        size_t i{1};
+        hostbench::Run(name, [&](uint64_t n)
+                       {
+            for (uint64_t k = 0; k < n; k++)
+            {
+                const RawRecord &prev = (*c.records)[i - 1];
+                const RawRecord &cur = (*c.records)[i];
+                hostbench::DoNotOptimize(DeltaVarintCodec::Encode(delta, (const uint8_t *)&prev, (const uint8_t *)&cur, out));
+                i = i + 1 == c.records->size() ? 1 : i + 1;
+            } });
+    }
+
+    // ganzer Schreibpfad; der Ring laeuft dabei um, die Sektor-Erases sind also anteilig mitgemessen
+    for (SectorCodec codec : {SectorCodec::RAW, SectorCodec::DELTA_VARINT})
+    {
+        for (const Case &c : cases)
+        {
+            char name[64];
+            std::snprintf(name, sizeof(name), "timeseries/write_%s/%s", codec == SectorCodec::RAW ? "raw" : "delta_varint", c.name);
+            Ring ring(codec);
+            uint64_t written{0};
+            double allocs = hostbench::Run(name, [&](uint64_t n)
+                                           {
+                for (uint64_t k = 0; k < n; k++, written++)
+                    ring.runtime.Write(&ring.partition.info, START_EPOCH + (time_t)(written * CFG.SECONDS_PER_RECORD), &(*c.records)[written % c.records->size()]); });
+            hostbench::Expect(allocs == 0, "writing a record does not allocate");
+        }
+    }
+
+    std::printf("\n%-22s %10s %14s %12s %8s\n", "retained history", "records", "bytes/record", "hours", "vs RAW");
+    for (const Case &c : cases)
+    {
+        History raw = MeasureHistory(SectorCodec::RAW, *c.records, "RAW ring holds the most recent records");
+        History compressed = MeasureHistory(SectorCodec::DELTA_VARINT, *c.records, "DELTA_VARINT ring decodes to the most recent records");
+        std::printf("%-22s %10zu %14.2f %12.1f %8s\n", (std::string("raw/") + c.name).c_str(), raw.records, raw.bytesPerRecord, raw.hours, "1.00x");
+        std::printf("%-22s %10zu %14.2f %12.1f %7.2fx\n", (std::string("delta_varint/") + c.name).c_str(), compressed.records, compressed.bytesPerRecord, compressed.hours, compressed.hours / raw.hours);
+        hostbench::Expect(raw.records > 0 && compressed.records > 0, "the rings hold records");
+        if (c.records == &slow)
+            hostbench::Expect(compressed.hours >= 3 * raw.hours, "DELTA_VARINT keeps at least 3x the history of RAW for slow signals");
+    }
+    return hostbench::Finish();
+}
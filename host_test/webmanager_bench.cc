@@ -0,0 +1,288 @@
+// Benchmarks des Websocket-Kerns auf dem Host: Dispatch eingehender Frames, Empfangspfad (ganze und
+// fragmentierte Frames) und Sendepfad (SendRawAsync, Zero-Copy ReserveFrame/CommitFrame, Broadcast) jeweils
+// inkl. Heap-Allokationen je Nachricht. Der Sendepfad laeuft bis zum httpd_ws_send_frame_async des Ersatzes,
+// also inkl. Drain im "httpd-Task" (host_httpd::RunQueuedWork).
+// Encode/Decode der Nachrichten fehlt bewusst: der dafuer noetige Code wird aus best_binary_buffers_schema
+// generiert und liegt nicht im Repository.
+#include <cstdint>
+#include <cstring>
+#include <array>
+#include "bench.hh"
+#include "webmanager_frame_pool.hh"
+#include "webmanager_sessions.hh"
+#include "webmanager_dispatch.hh"
+#include "webmanager_receiver.hh"
+
+using namespace webmanager;
+
+namespace
+{
+    int serverDummy{0};
+    const httpd_handle_t SERVER{&serverDummy};
+    uint64_t handled{0};
+    uint64_t streamedBytes{0};
+
+    class BenchPlugin : public iWebmanagerPlugin
+    {
+    private:
+        uint16_t namespaceId;
+
+    public:
+        explicit BenchPlugin(uint16_t namespaceId) : namespaceId(namespaceId) {}
+        void OnBegin(iWebmanagerCallback *callback) override { (void)(callback); }
+        void OnWifiConnect(iWebmanagerCallback *callback) override { (void)(callback); }
+        void OnWifiDisconnect(iWebmanagerCallback *callback) override { (void)(callback); }
+        void OnTimeUpdate(iWebmanagerCallback *callback) override { (void)(callback); }
+        // ohne festen Namespace (Fallback-Liste) wird wie bisher selbst verglichen
+        uint16_t GetNamespaceId() override { return namespaceId; }
+        eMessageReceiverResult ProvideWebsocketMessage(iWebmanagerCallback *callback, httpd_req_t *req, httpd_ws_frame_t *ws_pkt, uint16_t ns, uint16_t messageTypeId, const uint8_t *frame, size_t frameLen) override
+        {
+            (void)(callback);
+            (void)(req);
+            (void)(ws_pkt);
+            (void)(messageTypeId);
+            (void)(frame);
+            (void)(frameLen);
+            if (namespaceId == WS_NAMESPACE_ANY && ns != 200)
+                return eMessageReceiverResult::NOT_FOR_ME;
+            handled++;
+            return eMessageReceiverResult::OK;
+        }
+    };
+
+    eMessageReceiverResult countingHandler(void *ctx, iWebmanagerCallback *callback, const uint8_t *frame, size_t frameLen)
+    {
+        (void)(ctx);
+        (void)(callback);
+        (void)(frame);
+        (void)(frameLen);
+        handled++;
+        return eMessageReceiverResult::OK;
+    }
+
+    eMessageReceiverResult countingStreamHandler(void *ctx, iWebmanagerCallback *callback, const uint8_t *chunk, size_t chunkLen, size_t offset, bool last)
+    {
+        (void)(ctx);
+        (void)(callback);
+        (void)(chunk);
+        (void)(offset);
+        streamedBytes += chunkLen;
+        if (last)
+            handled++;
+        return eMessageReceiverResult::OK;
+    }
+
+    void writeHeader(uint8_t *buf, uint16_t ns, uint16_t type)
+    {
+        buf[0] = (uint8_t)ns;
+        buf[1] = (uint8_t)(ns >> 8);
+        buf[2] = (uint8_t)type;
+        buf[3] = (uint8_t)(type >> 8);
+    }
+
+    bool poolIsEmpty(FramePool &pool)
+    {
+        FramePoolStats stats = pool.GetStats();
+        for (auto n : stats.inUse)
+            if (n)
+                return false;
+        return true;
+    }
+
+    // 10 Namespaces mit je 2 registrierten Handlern, ein Plugin im direkt indizierten Slot, 10 Plugins ohne
+    // festen Namespace in der linearen Liste (das letzte bedient Namespace 200)
+    void setupDispatch(WsDispatchTable &dispatch, std::array<BenchPlugin, 10> &fallbackPlugins, BenchPlugin &slotPlugin)
+    {
+        for (uint16_t ns = 0; ns < 10; ns++)
+            for (uint16_t type = 0; type < 2; type++)
+                dispatch.RegisterHandler(ns, type, countingHandler, nullptr);
+        dispatch.RegisterStreamHandler(3, 7, countingStreamHandler, nullptr);
+        dispatch.AddPlugin(&slotPlugin);
+        for (auto &p : fallbackPlugins)
+            dispatch.AddPlugin(&p);
+    }
+
+    void benchDispatch(WsDispatchTable &dispatch, WsSession *session)
+    {
+        uint8_t frame[16]{};
+        struct Case
+        {
+            const char *name;
+            uint16_t ns;
+            uint16_t type;
+        };
+        const Case cases[]{
+            {"dispatch/registered_handler", 7, 1},
+            {"dispatch/namespace_slot_plugin", 20, 3},
+            {"dispatch/linear_fallback_10_plugins", 200, 3},
+        };
+        for (const auto &c : cases)
+        {
+            writeHeader(frame, c.ns, c.type);
+            handled = 0;
+            uint64_t total{0};
+            double allocs = hostbench::Run(c.name, [&](uint64_t n)
+                                           {
+                for (uint64_t i = 0; i < n; i++)
+                    hostbench::DoNotOptimize(dispatch.Dispatch(session, nullptr, nullptr, c.ns, c.type, frame, sizeof(frame)));
+                total += n; });
+            hostbench::Expect(handled == total, "every dispatched frame reaches its handler");
+            hostbench::Expect(allocs == 0, "dispatch does not allocate");
+        }
+    }
+
+    void benchReceive(WsDispatchTable &dispatch, WsSession *session, int fd)
+    {
+        WsReceiver rx(&dispatch);
+        static uint8_t payload[3 * 1024];
+        httpd_req_t req{SERVER, 0, fd, nullptr};
+
+        writeHeader(payload, 7, 1);
+        httpd_ws_frame_t whole{true, false, HTTPD_WS_TYPE_BINARY, payload, 64};
+        handled = 0;
+        uint64_t total{0};
+        double allocs = hostbench::Run("receive/whole_frame_64B", [&](uint64_t n)
+                                       {
+            req.incoming = &whole;
+            for (uint64_t i = 0; i < n; i++)
+                rx.Receive(&req, session);
+            total += n; });
+        hostbench::Expect(handled == total, "every whole frame is dispatched");
+        hostbench::Expect(allocs == 0, "receiving a whole frame does not allocate");
+
+        struct Case
+        {
+            const char *name;
+            uint16_t type;
+        };
+        const Case cases[]{
+            {"receive/fragmented_3x1KiB_reassemble", 1},
+            {"receive/fragmented_3x1KiB_stream", 7},
+        };
+        for (const auto &c : cases)
+        {
+            writeHeader(payload, 3, c.type);
+            const httpd_ws_frame_t fragments[3]{
+                {false, true, HTTPD_WS_TYPE_BINARY, payload, 1024},
+                {false, true, HTTPD_WS_TYPE_CONTINUE, payload + 1024, 1024},
+                {true, true, HTTPD_WS_TYPE_CONTINUE, payload + 2048, 1024},
+            };
+            handled = 0;
+            total = 0;
+            allocs = hostbench::Run(c.name, [&](uint64_t n)
+                                    {
+                for (uint64_t i = 0; i < n; i++)
+                {
+                    for (const auto &fragment : fragments)
+                    {
+                        req.incoming = &fragment;
+                        rx.Receive(&req, session);
+                    }
+                }
+                total += n; });
+            hostbench::Expect(handled == total, "every fragmented message is dispatched once");
+            hostbench::Expect(allocs == 0, "receiving a fragmented message does not allocate");
+        }
+        hostbench::Expect(rx.GetStats().oversizeFrames == 0, "no frame exceeded the receive buffer");
+    }
+
+    void benchSend(FramePool &pool, WsSessionTable &table, WsSession *session)
+    {
+        uint8_t message[48]{};
+        writeHeader(message, 5, 2);
+
+        uint64_t before = host_httpd::state.sentFrames;
+        uint64_t total{0};
+        double allocs = hostbench::Run("send/SendRawAsync_48B", [&](uint64_t n)
+                                       {
+            for (uint64_t i = 0; i < n; i++)
+            {
+                session->SendRawAsync(message, sizeof(message));
+                host_httpd::RunQueuedWork();
+            }
+            total += n; });
+        hostbench::Expect(host_httpd::state.sentFrames - before == total, "SendRawAsync delivers every frame");
+        hostbench::Expect(allocs == 0, "SendRawAsync does not allocate");
+
+        before = host_httpd::state.sentFrames;
+        total = 0;
+        allocs = hostbench::Run("send/ReserveFrame_CommitFrame_48B", [&](uint64_t n)
+                                {
+            for (uint64_t i = 0; i < n; i++)
+            {
+                PooledFrame *f = session->ReserveFrame(sizeof(message));
+                std::memcpy(f->buffer, message, sizeof(message));
+                session->CommitFrame(f, sizeof(message));
+                host_httpd::RunQueuedWork();
+            }
+            total += n; });
+        hostbench::Expect(host_httpd::state.sentFrames - before == total, "CommitFrame delivers every frame");
+        hostbench::Expect(allocs == 0, "ReserveFrame/CommitFrame do not allocate");
+
+        // Schub von WS_SESSION_QUEUE_LEN Frames, bevor der httpd-Task zum Zug kommt
+        before = host_httpd::state.sentFrames;
+        total = 0;
+        allocs = hostbench::Run("send/SendRawAsync_48B_burst_of_8", [&](uint64_t n)
+                                {
+            for (uint64_t i = 0; i < n; i++)
+            {
+                for (size_t k = 0; k < WS_SESSION_QUEUE_LEN; k++)
+                    session->SendRawAsync(message, sizeof(message));
+                host_httpd::RunQueuedWork();
+            }
+            total += n * WS_SESSION_QUEUE_LEN; });
+        hostbench::Expect(host_httpd::state.sentFrames - before == total, "a burst that fits the session ring is delivered completely");
+        hostbench::Expect(allocs == 0, "a send burst does not allocate");
+
+        const size_t sizes[]{48, 1400};
+        for (size_t len : sizes)
+        {
+            before = host_httpd::state.sentFrames;
+            total = 0;
+            allocs = hostbench::Run(len == 48 ? "send/Broadcast_48B_4_sessions" : "send/Broadcast_1400B_4_sessions", [&](uint64_t n)
+                                    {
+                for (uint64_t i = 0; i < n; i++)
+                {
+                    PooledFrame *f = pool.Reserve(len);
+                    writeHeader(f->buffer, 5, 3);
+                    f->len = len;
+                    table.Broadcast(f);
+                    host_httpd::RunQueuedWork();
+                }
+                total += n * table.Count(); });
+            hostbench::Expect(host_httpd::state.sentFrames - before == total, "Broadcast reaches every session");
+            hostbench::Expect(allocs == 0, "Broadcast does not allocate");
+        }
+        hostbench::Expect(poolIsEmpty(pool), "all pool frames are released after sending");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    hostbench::ParseArgs(argc, argv);
+    host_log_level = ESP_LOG_ERROR;
+
+    FramePool pool;
+    WsSessionTable table(&pool);
+    table.SetServer(SERVER);
+    WsSession *sessions[WS_MAX_SESSIONS]{};
+    for (size_t i = 0; i < WS_MAX_SESSIONS; i++)
+    {
+        int fd = 50 + (int)i;
+        host_httpd::SetWebsocket(fd, true);
+        sessions[i] = table.Register(fd);
+    }
+    hostbench::Expect(table.Count() == WS_MAX_SESSIONS, "all sessions registered");
+
+    WsDispatchTable dispatch;
+    std::array<BenchPlugin, 10> fallbackPlugins{BenchPlugin(WS_NAMESPACE_ANY), BenchPlugin(WS_NAMESPACE_ANY), BenchPlugin(WS_NAMESPACE_ANY), BenchPlugin(WS_NAMESPACE_ANY), BenchPlugin(WS_NAMESPACE_ANY),
+                                                BenchPlugin(WS_NAMESPACE_ANY), BenchPlugin(WS_NAMESPACE_ANY), BenchPlugin(WS_NAMESPACE_ANY), BenchPlugin(WS_NAMESPACE_ANY), BenchPlugin(WS_NAMESPACE_ANY)};
+    BenchPlugin slotPlugin(20);
+    setupDispatch(dispatch, fallbackPlugins, slotPlugin);
+
+    benchDispatch(dispatch, sessions[0]);
+    benchReceive(dispatch, sessions[0], sessions[0]->GetFd());
+    benchSend(pool, table, sessions[0]);
+    hostbench::Expect(host_httpd::state.sentFrames == table.GetSendStats().sentFrames, "send statistics match the frames handed to httpd");
+    return hostbench::Finish();
+}